@@ -0,0 +1,172 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+//
+// Compares quick's std::ostream printers (quick/debug.hpp), which render
+// nested containers of numbers and strings into a single buffer, with a copy
+// of the per-token printers they replaced, for containers of various shapes.
+// Usage: ./debug_benchmark [--json] [--samples=N] [--min_sample_ms=N]
+//                          [filter]
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "quick/benchmark.hpp"
+#include "quick/debug.hpp"
+
+namespace {
+
+// Copy of the per-token printers, as they were before the single buffer
+// rendering and the DebugLimits: one std::ostream call per token.
+namespace per_token {
+
+template<typename T>
+void Print(std::ostream& os, const T& input);
+template<typename T1, typename T2>
+void Print(std::ostream& os, const std::pair<T1, T2>& input);
+template<typename... Ts>
+void Print(std::ostream& os, const std::tuple<Ts...>& input);
+template<typename... Ts>
+void Print(std::ostream& os, const std::vector<Ts...>& input);
+template<typename... Ts>
+void Print(std::ostream& os, const std::map<Ts...>& input);
+template<typename... Ts>
+void Print(std::ostream& os, const std::unordered_map<Ts...>& input);
+
+template<typename T>
+void Print(std::ostream& os, const T& input) {
+  os << input;
+}
+
+template<typename T1, typename T2>
+void Print(std::ostream& os, const std::pair<T1, T2>& input) {
+  os << "(";
+  Print(os, input.first);
+  os << ", ";
+  Print(os, input.second);
+  os << ")";
+}
+
+template<typename... Ts, std::size_t... index>
+void PrintTupleImpl(std::ostream& os, const std::tuple<Ts...>& input,
+                    std::index_sequence<index...>) {
+  using expander = int[];
+  (void) expander {0, ((void) (os << (index == 0 ? "" : ", ")),
+                       Print(os, std::get<index>(input)), 0)...};
+}
+
+template<typename... Ts>
+void Print(std::ostream& os, const std::tuple<Ts...>& input) {
+  os << "(";
+  PrintTupleImpl(os, input, std::index_sequence_for<Ts...>());
+  os << ")";
+}
+
+template<typename Container>
+void PrintContainer(std::ostream& os, const Container& input) {
+  os << "[";
+  bool is_first_item = true;
+  for (auto& item : input) {
+    os << (is_first_item ? "" : ", ");
+    Print(os, item);
+    is_first_item = false;
+  }
+  os << "]";
+}
+
+template<typename MapContainer>
+void PrintMap(std::ostream& os, const MapContainer& input) {
+  os << "{";
+  bool is_first_item = true;
+  for (auto& item : input) {
+    os << (is_first_item ? "" : ", ");
+    Print(os, item.first);
+    os << ": ";
+    Print(os, item.second);
+    is_first_item = false;
+  }
+  os << "}";
+}
+
+template<typename... Ts>
+void Print(std::ostream& os, const std::vector<Ts...>& input) {
+  PrintContainer(os, input);
+}
+
+template<typename... Ts>
+void Print(std::ostream& os, const std::map<Ts...>& input) {
+  PrintMap(os, input);
+}
+
+template<typename... Ts>
+void Print(std::ostream& os, const std::unordered_map<Ts...>& input) {
+  PrintMap(os, input);
+}
+
+}  // namespace per_token
+
+// Prints `input` into a fresh std::ostringstream.
+template<typename T>
+std::string Print(const T& input, bool per_token) {
+  std::ostringstream oss;
+  if (per_token) {
+    per_token::Print(oss, input);
+  } else {
+    oss << input;
+  }
+  return oss.str();
+}
+
+template<typename T>
+void Run(qk::BenchmarkRunner& runner,  // NOLINT
+         const std::string& name, const T& input) {
+  if (Print(input, true) != Print(input, false)) {
+    std::cerr << name << ": the outputs differ" << std::endl;
+    std::exit(1);
+  }
+  auto per_token = runner.Run(name + "/per_token", [&]() {
+    qk::DoNotOptimize(Print(input, true).size());
+  });
+  auto fast = runner.Run(name + "/fast", [&]() {
+    qk::DoNotOptimize(Print(input, false).size());
+  });
+  // Keeps the --json output parsable.
+  if (not runner.Options().json && per_token.Mean() > 0 && fast.Mean() > 0) {
+    std::cout << name << ": speedup = " << (per_token.Mean() / fast.Mean())
+              << "x" << std::endl;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  qk::BenchmarkRunner runner(qk::BenchmarkOptions::FromArgs(argc, argv));
+  std::vector<int> flat(10000);
+  for (std::size_t i = 0; i < flat.size(); i++) {
+    flat[i] = static_cast<int>(i * 7919);
+  }
+  std::vector<std::vector<int>> nested(100, std::vector<int>(100, 42));
+  std::vector<std::vector<std::vector<int64_t>>> deep(
+      20, std::vector<std::vector<int64_t>>(20, {1, -2, 3, 1LL << 40}));
+  std::map<std::string, std::vector<double>> string_map;
+  std::unordered_map<int, std::pair<int, std::string>> pair_map;
+  std::vector<std::tuple<int, char, std::string, float>> tuples;
+  for (int i = 0; i < 1000; i++) {
+    string_map["key_" + std::to_string(i)] = {i * 0.5, 1e-3, 1e10};
+    pair_map[i] = std::make_pair(-i, "value");
+    tuples.emplace_back(i, 'x', "text", i / 3.0f);
+  }
+  Run(runner, "vector<int>", flat);
+  Run(runner, "vector<vector<int>>", nested);
+  Run(runner, "vector<vector<vector<int64_t>>>", deep);
+  Run(runner, "map<string, vector<double>>", string_map);
+  Run(runner, "unordered_map<int, pair<int, string>>", pair_map);
+  Run(runner, "vector<tuple<int, char, string, float>>", tuples);
+  return 0;
+}
@@ -0,0 +1,159 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+//
+// Micro-benchmarks of quick's hot paths (ByteStream, hash, DebugStream and
+// stl_utils) over fixed datasets, so that runs are comparable across commits.
+// Usage: ./quick_benchmark [--json] [--samples=N] [--min_sample_ms=N] [filter]
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "quick/benchmark.hpp"
+#include "quick/byte_stream.hpp"
+#include "quick/debug_stream.hpp"
+#include "quick/hash.hpp"
+#include "quick/stl_utils.hpp"
+
+namespace {
+
+struct Dataset {
+  std::vector<int> ints;
+  std::vector<std::string> strings;
+  std::map<std::string, std::vector<int64_t>> string_map;
+  std::unordered_map<int, std::pair<double, std::string>> pair_map;
+  std::set<int> odd_set;
+  std::set<int> multiple_of_3_set;
+
+  Dataset() {
+    uint64_t state = 12345;
+    auto next = [&state]() {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      return static_cast<int>(state >> 33);
+    };
+    for (int i = 0; i < 10000; i++) {
+      ints.push_back(next());
+    }
+    for (int i = 0; i < 1000; i++) {
+      strings.push_back("string_" + std::to_string(next()));
+      string_map[strings.back()] = {next(), -next(), int64_t(1) << 40};
+      pair_map[i] = std::make_pair(next() / 7.0, strings.back());
+      odd_set.insert(2 * i + 1);
+      multiple_of_3_set.insert(3 * i);
+    }
+  }
+};
+
+void ByteStreamBenchmarks(qk::BenchmarkRunner& runner,  // NOLINT
+                          const Dataset& data) {
+  qk::ByteStream bs;
+  runner.Run("ByteStream/Serialize/vector<int>", [&]() {
+    bs.Clear();
+    bs << data.ints;
+    qk::DoNotOptimize(bs.str().size());
+  });
+  runner.Run("ByteStream/Serialize/map<string, vector<int64_t>>", [&]() {
+    bs.Clear();
+    bs << data.string_map;
+    qk::DoNotOptimize(bs.str().size());
+  });
+  qk::ByteStream encoded_ints;
+  encoded_ints << data.ints;
+  runner.Run("ByteStream/Deserialize/vector<int>", [&]() {
+    qk::ByteStream input;
+    input.str(encoded_ints.str());
+    std::vector<int> output;
+    input >> output;
+    qk::DoNotOptimize(output.data());
+  });
+  qk::ByteStream encoded_map;
+  encoded_map << data.string_map;
+  runner.Run("ByteStream/Deserialize/map<string, vector<int64_t>>", [&]() {
+    qk::ByteStream input;
+    input.str(encoded_map.str());
+    std::map<std::string, std::vector<int64_t>> output;
+    input >> output;
+    qk::DoNotOptimize(output.size());
+  });
+}
+
+void HashBenchmarks(qk::BenchmarkRunner& runner,  // NOLINT
+                    const Dataset& data) {
+  runner.Run("hash/int", [&]() {
+    std::size_t h = 0;
+    for (int i = 0; i < 1000; i++) {
+      h += qk::hash<int>()(data.ints[i]);
+    }
+    qk::DoNotOptimize(h);
+  });
+  runner.Run("hash/string", [&]() {
+    qk::DoNotOptimize(qk::hash<std::string>()(data.strings[0]));
+  });
+  runner.Run("hash/vector<int>", [&]() {
+    qk::DoNotOptimize(qk::hash<std::vector<int>>()(data.ints));
+  });
+  runner.Run("hash/map<string, vector<int64_t>>", [&]() {
+    using Map = std::map<std::string, std::vector<int64_t>>;
+    qk::DoNotOptimize(qk::hash<Map>()(data.string_map));
+  });
+}
+
+void DebugStreamBenchmarks(qk::BenchmarkRunner& runner,  // NOLINT
+                           const Dataset& data) {
+  qk::DebugStream ds;
+  runner.Run("DebugStream/vector<int>", [&]() {
+    ds.Clear() << data.ints;
+    qk::DoNotOptimize(ds.str().size());
+  });
+  runner.Run("DebugStream/map<string, vector<int64_t>>", [&]() {
+    ds.Clear() << data.string_map;
+    qk::DoNotOptimize(ds.str().size());
+  });
+  runner.Run("DebugStream/unordered_map<int, pair<double, string>>", [&]() {
+    ds.Clear() << data.pair_map;
+    qk::DoNotOptimize(ds.str().size());
+  });
+  qk::DebugStream json;
+  json.SetJson(true);
+  runner.Run("DebugStream/Json/map<string, vector<int64_t>>", [&]() {
+    json.Clear() << data.string_map;
+    qk::DoNotOptimize(json.str().size());
+  });
+}
+
+void StlUtilsBenchmarks(qk::BenchmarkRunner& runner,  // NOLINT
+                        const Dataset& data) {
+  runner.Run("stl_utils/StringJoin", [&]() {
+    qk::DoNotOptimize(qk::StringJoin(data.strings, ", ").size());
+  });
+  runner.Run("stl_utils/SetUnion", [&]() {
+    qk::DoNotOptimize(
+        qk::SetUnion(data.odd_set, data.multiple_of_3_set).size());
+  });
+  runner.Run("stl_utils/SetMinus", [&]() {
+    qk::DoNotOptimize(
+        qk::SetMinus(data.odd_set, data.multiple_of_3_set).size());
+  });
+  runner.Run("stl_utils/ToSet", [&]() {
+    qk::DoNotOptimize(qk::ToSet(data.ints).size());
+  });
+  runner.Run("stl_utils/STLGetKeys", [&]() {
+    qk::DoNotOptimize(qk::STLGetKeys(data.string_map).size());
+  });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const Dataset data;
+  qk::BenchmarkRunner runner(qk::BenchmarkOptions::FromArgs(argc, argv));
+  ByteStreamBenchmarks(runner, data);
+  HashBenchmarks(runner, data);
+  DebugStreamBenchmarks(runner, data);
+  StlUtilsBenchmarks(runner, data);
+  return 0;
+}
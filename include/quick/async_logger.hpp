@@ -0,0 +1,200 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#ifndef QUICK_ASYNC_LOGGER_HPP_
+#define QUICK_ASYNC_LOGGER_HPP_
+
+// Logging front end, where the calling thread only formats the record into a
+// thread-local quick::DebugStream and hands it to a lock-free queue. A
+// background thread batches the records and writes them to the sink.
+//
+// Sample usage:
+// qk::AsyncLogger logger(qk::FileDescriptorSink(2));
+// logger.Log("request_id = ", id, ", params = ", params_map);
+// logger.Flush();  // Optional, waits until all logged records are written.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "quick/debug_stream.hpp"
+#include "quick/mpsc_ring_buffer.hpp"
+
+namespace quick {
+
+class AsyncLogger {
+ public:
+  // Appends the output for a `record` to the `batch` being written. Called
+  // from the background thread only.
+  using RecordHandler = std::function<void(const std::string& record,
+                                           std::string* batch)>;
+
+  // `queue_capacity` (power of 2) bounds the number of records waiting to be
+  // written. Records logged while the queue is full are dropped, instead of
+  // blocking the caller. `sink` is called from the background thread only.
+  explicit AsyncLogger(DebugStream::Sink sink,
+                       std::size_t queue_capacity = 1 << 14,
+                       std::size_t batch_size = 1 << 16)
+      : AsyncLogger(std::move(sink), nullptr, queue_capacity, batch_size) {}
+
+  // Records are passed through `record_handler`, if set, instead of being
+  // written as is.
+  AsyncLogger(DebugStream::Sink sink,
+              RecordHandler record_handler,
+              std::size_t queue_capacity = 1 << 14,
+              std::size_t batch_size = 1 << 16)
+      : sink_(std::move(sink)),
+        record_handler_(std::move(record_handler)),
+        queue_(queue_capacity),
+        batch_size_(batch_size),
+        writer_([this]() { this->RunWriter(); }) {}
+
+  AsyncLogger(const AsyncLogger&) = delete;
+  AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+  // Writes all the records logged so far, and stops the background thread.
+  ~AsyncLogger() {
+    stop_.store(true, std::memory_order_release);
+    writer_.join();
+  }
+
+  // Formats `args` as a single inline line, ex: Log("x = ", x). Returns false
+  // if the record is dropped because the queue is full. Thread safe.
+  template<typename... Ts>
+  bool Log(const Ts&... args) {
+    auto& thread_context = GetThreadContext();
+    if (thread_context.in_use) {
+      // Reentered, ex: from a DebugStream hook logging to another logger.
+      ThreadContext context;
+      return LogWith(context, args...);
+    }
+    thread_context.in_use = true;
+    try {
+      bool pushed = LogWith(thread_context, args...);
+      thread_context.in_use = false;
+      return pushed;
+    } catch (...) {
+      thread_context.in_use = false;
+      throw;
+    }
+  }
+
+  // Enqueues a record formatted by the caller, by swapping it with a recycled
+  // buffer. `record` is left untouched if it's dropped. Thread safe.
+  bool LogRecord(std::string& record) {  // NOLINT
+    bool pushed = queue_.TryPush(record);
+    if (not pushed) {
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return pushed;
+  }
+
+  // Blocks until every record logged before this call is written to the sink.
+  // Records are written in the order of their positions in the queue, hence
+  // waits for all the positions claimed so far, including the ones of records
+  // still being pushed by other threads.
+  void Flush() {
+    uint64_t target = queue_.num_claimed();
+    while (num_written_.load(std::memory_order_acquire) < target) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+  // Number of records dropped, either because the queue was full or the sink
+  // threw an exception.
+  uint64_t num_dropped() const {
+    return num_dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Buffers reused across the records logged by a thread.
+  struct ThreadContext {
+    DebugStream ds;
+    std::string record;
+    bool in_use = false;
+    ThreadContext() {
+      ds.SetInline(true);
+    }
+  };
+
+  template<typename... Ts>
+  bool LogWith(ThreadContext& context, const Ts&... args) {  // NOLINT
+    context.ds.Clear();
+    context.ds.Consume(args...).Append('\n');
+    context.ds.SwapBuffer(context.record);
+    bool pushed = LogRecord(context.record);
+    // Takes back either the record or a recycled buffer from the queue.
+    context.ds.SwapBuffer(context.record);
+    return pushed;
+  }
+
+  static ThreadContext& GetThreadContext() {
+    static thread_local ThreadContext context;
+    return context;
+  }
+
+  void WriteBatch(std::string& batch, uint64_t num_records) {  // NOLINT
+    try {
+      sink_(batch.data(), batch.size());
+    } catch (...) {
+      num_dropped_.fetch_add(num_records, std::memory_order_relaxed);
+    }
+    batch.clear();
+  }
+
+  void RunWriter() {
+    std::string record, batch;
+    batch.reserve(batch_size_);
+    int64_t idle_wait_us = 1;
+    while (true) {
+      bool stopping = stop_.load(std::memory_order_acquire);
+      uint64_t num_popped = 0, num_in_batch = 0;
+      while (queue_.TryPop(record)) {
+        if (record_handler_) {
+          record_handler_(record, &batch);
+        } else {
+          batch += record;
+        }
+        num_popped++;
+        num_in_batch++;
+        if (batch.size() >= batch_size_) {
+          WriteBatch(batch, num_in_batch);
+          num_in_batch = 0;
+        }
+      }
+      if (not batch.empty()) {
+        WriteBatch(batch, num_in_batch);
+      }
+      num_written_.fetch_add(num_popped, std::memory_order_release);
+      if (num_popped > 0) {
+        idle_wait_us = 1;
+      } else if (stopping) {
+        break;
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(idle_wait_us));
+        idle_wait_us = std::min<int64_t>(idle_wait_us * 2, 1000);
+      }
+    }
+  }
+
+  DebugStream::Sink sink_;
+  RecordHandler record_handler_;
+  MpscRingBuffer<std::string> queue_;
+  std::size_t batch_size_;
+  std::atomic<bool> stop_ {false};
+  std::atomic<uint64_t> num_written_ {0};
+  std::atomic<uint64_t> num_dropped_ {0};
+  // Declared last, so that it's started after the other members are ready.
+  std::thread writer_;
+};
+
+}  // namespace quick
+
+namespace qk = quick;
+
+#endif  // QUICK_ASYNC_LOGGER_HPP_
@@ -0,0 +1,210 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#ifndef QUICK_BENCHMARK_HPP_
+#define QUICK_BENCHMARK_HPP_
+
+// Micro-benchmark harness. The number of iterations per sample is calibrated
+// so that a sample lasts at least `min_sample_time_ns`, the code is warmed up,
+// and the time per iteration is summarised over `num_samples` samples.
+//
+// Sample usage:
+// qk::BenchmarkRunner runner(qk::BenchmarkOptions::FromArgs(argc, argv));
+// std::vector<int> input = ....;
+// runner.Run("hash/vector<int>", [&]() {
+//   qk::DoNotOptimize(qk::hash<std::vector<int>>()(input));
+// });
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "quick/debug_stream.hpp"
+#include "quick/time.hpp"
+
+namespace quick {
+
+// Prevents the compiler from optimizing away the computation of `value`.
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+  __asm__ __volatile__("" : : "m"(value) : "memory");
+}
+
+// Forces the pending writes to memory, ex: after filling a buffer which is
+// never read.
+inline void ClobberMemory() {
+  __asm__ __volatile__("" : : : "memory");
+}
+
+struct BenchmarkOptions {
+  int64_t min_sample_time_ns = 5 * 1000 * 1000;
+  int64_t warmup_time_ns = 20 * 1000 * 1000;
+  int num_samples = 15;
+  // Only the benchmarks whose name contains `filter` are run.
+  std::string filter;
+  bool json = false;
+
+  // Usage: ./benchmark [--json] [--samples=N] [--min_sample_ms=N] [filter]
+  static BenchmarkOptions FromArgs(int argc, char** argv) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--json") {
+        options.json = true;
+      } else if (arg.compare(0, 10, "--samples=") == 0) {
+        options.num_samples = std::max(std::stoi(arg.substr(10)), 1);
+      } else if (arg.compare(0, 16, "--min_sample_ms=") == 0) {
+        options.min_sample_time_ns = std::stoll(arg.substr(16)) * 1000000;
+      } else {
+        options.filter = arg;
+      }
+    }
+    return options;
+  }
+};
+
+struct BenchmarkResult {
+  std::string name;
+  uint64_t iterations_per_sample = 0;
+  // Nano seconds per iteration.
+  std::vector<double> samples;
+
+  double Mean() const {
+    double sum = 0;
+    for (double sample : samples) {
+      sum += sample;
+    }
+    return samples.empty() ? 0 : sum / samples.size();
+  }
+  // Sample standard deviation.
+  double StdDev() const {
+    if (samples.size() < 2) {
+      return 0;
+    }
+    double mean = Mean(), sum = 0;
+    for (double sample : samples) {
+      sum += (sample - mean) * (sample - mean);
+    }
+    return std::sqrt(sum / (samples.size() - 1));
+  }
+  double Min() const {
+    return samples.empty() ? 0 : *std::min_element(samples.begin(),
+                                                   samples.end());
+  }
+  double Median() const {
+    if (samples.empty()) {
+      return 0;
+    }
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    std::size_t middle = sorted.size() / 2;
+    return sorted.size() % 2 == 1 ? sorted[middle]
+                                  : (sorted[middle - 1] + sorted[middle]) / 2;
+  }
+
+  // One line, ex:
+  // "hash/vector<int>     1234.5 ns +- 0.8%  (min 1220.1, median 1230.0)".
+  std::string Summary() const {
+    double mean = Mean();
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer),
+                  "%-52s %12.1f ns +- %4.1f%%  (min %.1f, median %.1f)",
+                  name.c_str(), mean, mean > 0 ? 100 * StdDev() / mean : 0,
+                  Min(), Median());
+    return buffer;
+  }
+
+  void DebugStream(quick::DebugStream& ds) const {  // NOLINT
+    ds.Field("name", name)
+      .Field("iterations_per_sample", iterations_per_sample)
+      .Field("mean_ns", Mean())
+      .Field("stddev_ns", StdDev())
+      .Field("min_ns", Min())
+      .Field("median_ns", Median());
+  }
+};
+
+class BenchmarkRunner {
+ public:
+  explicit BenchmarkRunner(BenchmarkOptions options = BenchmarkOptions(),
+                           std::ostream& os = std::cout)
+      : options_(std::move(options)), os_(os) {}
+
+  // With --json, prints all the results as a JSON array.
+  ~BenchmarkRunner() {
+    if (options_.json) {
+      os_ << quick::DebugStream().SetJson(true).Consume(results_).str()
+          << std::endl;
+    }
+  }
+
+  // Measures `function()`, a single iteration, unless filtered out. Returns
+  // the result, without samples if skipped.
+  template<typename F>
+  BenchmarkResult Run(const std::string& name, F&& function) {
+    BenchmarkResult result;
+    result.name = name;
+    if (name.find(options_.filter) == std::string::npos) {
+      return result;
+    }
+    NanoTimer warmup_timer;
+    uint64_t iterations = 1;
+    while (true) {
+      int64_t elapsed = RunBatch(function, iterations);
+      if (elapsed >= options_.min_sample_time_ns) {
+        break;
+      }
+      // Grows towards the target, with some margin, at most 10x at a time.
+      double scale = elapsed > 0 ? 1.2 * options_.min_sample_time_ns / elapsed
+                                 : 10;
+      iterations = static_cast<uint64_t>(iterations *
+                                         std::min(std::max(scale, 2.0), 10.0));
+    }
+    while (warmup_timer.GetElapsedTime() < options_.warmup_time_ns) {
+      RunBatch(function, iterations);
+    }
+    result.iterations_per_sample = iterations;
+    for (int i = 0; i < options_.num_samples; i++) {
+      result.samples.push_back(
+          static_cast<double>(RunBatch(function, iterations)) / iterations);
+    }
+    if (not options_.json) {
+      os_ << result.Summary() << std::endl;
+    }
+    results_.push_back(result);
+    return result;
+  }
+
+  const std::vector<BenchmarkResult>& Results() const {
+    return results_;
+  }
+
+  const BenchmarkOptions& Options() const {
+    return options_;
+  }
+
+ private:
+  template<typename F>
+  static int64_t RunBatch(F& function, uint64_t iterations) {  // NOLINT
+    NanoTimer timer;
+    for (uint64_t i = 0; i < iterations; i++) {
+      function();
+    }
+    return timer.GetElapsedTime();
+  }
+
+  BenchmarkOptions options_;
+  std::ostream& os_;
+  std::vector<BenchmarkResult> results_;
+};
+
+}  // namespace quick
+
+namespace qk = quick;
+
+#endif  // QUICK_BENCHMARK_HPP_
@@ -0,0 +1,266 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#ifndef QUICK_BINARY_LOGGER_HPP_
+#define QUICK_BINARY_LOGGER_HPP_
+
+// Logging with deferred formatting, for hot paths. The calling thread only
+// serializes the arguments with quick::ByteStream into a binary record, tagged
+// with the id of the argument types. Formatting with quick::DebugStream
+// happens later, either in the background thread of the logger, or offline by
+// quick::DecodeBinaryLog.
+//
+// Arguments must be serializable with ByteStream, default constructible and
+// printable with DebugStream. `const char*` arguments are decoded as
+// std::string.
+//
+// Sample usage:
+// qk::BinaryLogger logger(qk::FileDescriptorSink(2));
+// logger.Log("request_id = ", id, ", params = ", params_vector);
+//
+// For offline formatting, the records are written in binary:
+// qk::BinaryLogger logger(qk::FileDescriptorSink(fd),
+//                          qk::BinaryLogger::BINARY);
+// ....
+// qk::DecodeBinaryLog(qk::ReadFile(file_name), qk::OstreamSink(std::cout));
+// The decoding program must be built with the same compiler, and must log or
+// register (with quick::RegisterBinaryLogSignature<Ts...>()) the argument
+// types of every record.
+
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+#include "quick/async_logger.hpp"
+#include "quick/byte_stream.hpp"
+#include "quick/debug_stream.hpp"
+
+namespace quick {
+namespace detail {
+
+using BinaryLogDecoder = void (*)(ByteStream&, DebugStream&);
+
+// Type used for decoding an argument of type T.
+template<typename T>
+using BinaryLogType = std::conditional_t<
+                        std::is_convertible<const T&, const char*>::value,
+                        std::string,
+                        std::decay_t<T>>;
+
+template<typename... Ts, std::size_t... index>
+void DecodeBinaryLogRecordImpl(ByteStream& bs,  // NOLINT
+                               DebugStream& ds,  // NOLINT
+                               std::index_sequence<index...>) {
+  std::tuple<Ts...> values;
+  bs >> values;
+  using expander = int[];
+  (void) expander {0, ((void) (ds << std::get<index>(values)), 0)...};
+}
+
+template<typename... Ts>
+void DecodeBinaryLogRecord(ByteStream& bs, DebugStream& ds) {  // NOLINT
+  DecodeBinaryLogRecordImpl<Ts...>(bs, ds, std::index_sequence_for<Ts...>());
+}
+
+class BinaryLogRegistry {
+ public:
+  static BinaryLogRegistry& Get() {
+    static BinaryLogRegistry registry;
+    return registry;
+  }
+
+  void Register(uint64_t id, BinaryLogDecoder decoder) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoders_[id] = decoder;
+  }
+
+  BinaryLogDecoder Find(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = decoders_.find(id);
+    return (it == decoders_.end()) ? nullptr : it->second;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, BinaryLogDecoder> decoders_;
+};
+
+// FNV-1a hash of the mangled type name, which is stable across the processes
+// built with the same compiler, unlike the address of the decoder.
+inline uint64_t BinaryLogSignatureHash(const char* type_name) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (; *type_name != 0; type_name++) {
+    hash = (hash ^ static_cast<uint8_t>(*type_name)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+template<typename... Ts>
+struct BinaryLogSignature {
+  static uint64_t Id() {
+    static const uint64_t id = Register();
+    return id;
+  }
+
+ private:
+  static uint64_t Register() {
+    uint64_t id = BinaryLogSignatureHash(typeid(std::tuple<Ts...>).name());
+    BinaryLogRegistry::Get().Register(id, &DecodeBinaryLogRecord<Ts...>);
+    return id;
+  }
+};
+
+}  // namespace detail
+
+// Makes records with argument types `Ts...` decodable in this process. Needed
+// only for decoding records logged by another process.
+template<typename... Ts>
+uint64_t RegisterBinaryLogSignature() {
+  return detail::BinaryLogSignature<detail::BinaryLogType<Ts>...>::Id();
+}
+
+// Formats a single binary `record` (as produced by BinaryLogger::Encode) into
+// `ds`. Returns false if the record can't be decoded.
+inline bool FormatBinaryLogRecord(const std::string& record,
+                                  DebugStream& ds) {  // NOLINT
+  ByteStream bs;
+  bs.str(record);
+  try {
+    uint64_t id;
+    bs >> id;
+    auto decoder = detail::BinaryLogRegistry::Get().Find(id);
+    if (decoder == nullptr) {
+      ds << "[quick::BinaryLogger]: Unknown record signature " << id;
+      return false;
+    }
+    decoder(bs, ds);
+  } catch (...) {
+    ds << "[quick::BinaryLogger]: Corrupted record";
+    return false;
+  }
+  return true;
+}
+
+class BinaryLogger {
+ public:
+  enum Mode {
+    // Records are formatted as text lines by the background thread.
+    TEXT,
+    // Records are written in binary, each prefixed by its size as uint32, for
+    // offline decoding with quick::DecodeBinaryLog.
+    BINARY
+  };
+
+  explicit BinaryLogger(DebugStream::Sink sink,
+                        Mode mode = TEXT,
+                        std::size_t queue_capacity = 1 << 14,
+                        std::size_t batch_size = 1 << 16)
+      : logger_(std::move(sink),
+                (mode == TEXT ? AsyncLogger::RecordHandler(&FormatRecord)
+                              : AsyncLogger::RecordHandler(&FrameRecord)),
+                queue_capacity,
+                batch_size) {}
+
+  // Serializes `args` into a binary record and enqueues it. Returns false if
+  // the record is dropped because the queue is full. Thread safe.
+  template<typename... Ts>
+  bool Log(const Ts&... args) {
+    auto& context = GetThreadContext();
+    Encode(&context.bs, args...);
+    context.bs.SwapBuffer(context.record);
+    bool pushed = logger_.LogRecord(context.record);
+    context.bs.SwapBuffer(context.record);
+    return pushed;
+  }
+
+  // Writes the record for `args` into `bs`.
+  template<typename... Ts>
+  static void Encode(ByteStream* bs, const Ts&... args) {
+    bs->Clear();
+    (*bs) << detail::BinaryLogSignature<detail::BinaryLogType<Ts>...>::Id();
+    using expander = int[];
+    (void) expander {0, ((void) ((*bs) << args), 0)...};
+  }
+
+  // Blocks until every record logged before this call is written to the sink.
+  void Flush() {
+    logger_.Flush();
+  }
+
+  uint64_t num_dropped() const {
+    return logger_.num_dropped();
+  }
+
+ private:
+  struct ThreadContext {
+    ByteStream bs;
+    std::string record;
+  };
+
+  static ThreadContext& GetThreadContext() {
+    static thread_local ThreadContext context;
+    return context;
+  }
+
+  static void FormatRecord(const std::string& record, std::string* batch) {
+    static thread_local DebugStream ds;
+    ds.Clear().SetInline(true);
+    FormatBinaryLogRecord(record, ds);
+    ds.Append('\n');
+    batch->append(ds.str());
+  }
+
+  static void FrameRecord(const std::string& record, std::string* batch) {
+    ByteStream bs;
+    bs << static_cast<uint32_t>(record.size());
+    batch->append(bs.str());
+    batch->append(record);
+  }
+
+  AsyncLogger logger_;
+};
+
+// Formats the records written by a BinaryLogger in BINARY mode, one line per
+// record. Returns the number of records which couldn't be decoded.
+inline uint64_t DecodeBinaryLog(const std::string& data,
+                                DebugStream::Sink sink) {
+  DebugStream ds;
+  ds.SetInline(true).SetSink(std::move(sink));
+  uint64_t num_failures = 0;
+  std::size_t pos = 0;
+  std::string record;
+  ByteStream size_bs;
+  while (pos + sizeof(uint32_t) <= data.size()) {
+    size_bs.Clear();
+    size_bs.str(data.substr(pos, sizeof(uint32_t)));
+    uint32_t record_size;
+    size_bs >> record_size;
+    pos += sizeof(uint32_t);
+    if (pos + record_size > data.size()) {
+      break;
+    }
+    record.assign(data, pos, record_size);
+    pos += record_size;
+    if (not FormatBinaryLogRecord(record, ds)) {
+      num_failures++;
+    }
+    ds.Append('\n');
+  }
+  if (pos != data.size()) {
+    ds << "[quick::BinaryLogger]: Truncated log\n";
+    num_failures++;
+  }
+  ds.Flush();
+  return num_failures;
+}
+
+}  // namespace quick
+
+namespace qk = quick;
+
+#endif  // QUICK_BINARY_LOGGER_HPP_
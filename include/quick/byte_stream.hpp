@@ -19,6 +19,11 @@
 #include <unordered_map>
 
 #include "quick/type_traits.hpp"
+#include "quick/variant.hpp"
+
+#if __cplusplus >= 201703L
+#include <variant>
+#endif
 
 namespace quick {
 namespace detail {
@@ -30,15 +35,29 @@ static const bool is_little_endian_system = IsLittleEndianSystem();
 }
 
 
-// Can Store at max 4G data.
+// Can Store at max 4G data. Views set with SetView() can be larger.
 class ByteStream {
+ public:
+  // Thrown when decoding reads past the end of the data, or invalid data.
   struct Error {
     enum Type {INVALID_READ};
     Type type;
   };
+
+ private:
   static constexpr bool little_endian_storage = true;
   std::string str_value;
-  uint32_t read_ptr = 0;
+  uint64_t read_ptr = 0;
+  // Set by SetView(). Reads come from here instead of `str_value`.
+  const char* view_data = nullptr;
+  uint64_t view_size = 0;
+
+  const char* ReadData() const {
+    return view_data != nullptr ? view_data : str_value.data();
+  }
+  uint64_t ReadSize() const {
+    return view_data != nullptr ? view_size : str_value.size();
+  }
 
  public:
   const std::string& str() const {
@@ -46,9 +65,31 @@ class ByteStream {
   }
   void str(const std::string& str_value) {
     this->str_value = str_value;
+    view_data = nullptr;
   }
   bool end() const {
-    return (read_ptr >= str_value.size());
+    return (read_ptr >= ReadSize());
+  }
+  // Clears the content but keeps the allocated buffer, for reuse.
+  void Clear() {
+    str_value.clear();
+    read_ptr = 0;
+    view_data = nullptr;
+  }
+  // Swaps the content with `other` without a copy, and resets the read
+  // pointer.
+  void SwapBuffer(std::string& other) {  // NOLINT
+    str_value.swap(other);
+    read_ptr = 0;
+    view_data = nullptr;
+  }
+  // Deserializes from `data` in place, without a copy, ex: from a
+  // quick::MappedFile. `data` must outlive the reads. Calling Clear(), str()
+  // or SwapBuffer() switches back to the owned buffer.
+  void SetView(const char* data, std::size_t size) {
+    view_data = (data != nullptr ? data : "");
+    view_size = size;
+    read_ptr = 0;
   }
 
   template<typename T>
@@ -72,16 +113,17 @@ class ByteStream {
   std::enable_if_t<(std::is_fundamental<T>::value ||
                     std::is_enum<T>::value), ByteStream>&
   operator>>(T& output) {
-    uint32_t len = str_value.size();
+    uint64_t len = ReadSize();
     if (read_ptr + sizeof(T) > len) {
       throw Error {Error::INVALID_READ};
     }
+    const char* data = ReadData();
     auto* output_ptr = reinterpret_cast<uint8_t*>(&output);
     if (little_endian_storage == detail::is_little_endian_system) {
-      std::memcpy(output_ptr, &str_value[read_ptr], sizeof(T));
+      std::memcpy(output_ptr, data + read_ptr, sizeof(T));
     } else {
       for (uint32_t i = 0; i < sizeof(T); i++) {
-        output_ptr[sizeof(T) -i - 1] = str_value[read_ptr + i];
+        output_ptr[sizeof(T) -i - 1] = data[read_ptr + i];
       }
     }
     read_ptr += sizeof(T);
@@ -96,15 +138,24 @@ class ByteStream {
     return bs;
   }
 
+  // Encoded same as std::string, hence can be decoded into std::string.
+  ByteStream& operator<<(const char* input) {
+    auto& bs = *this;
+    uint64_t input_size = std::strlen(input);
+    bs << input_size;
+    str_value.append(input, input_size);
+    return bs;
+  }
+
   ByteStream& operator>>(std::string& output) {
     auto& bs = *this;
     uint64_t string_size;
     bs >> string_size;
-    if (bs.read_ptr + string_size > bs.str_value.size()) {
+    if (string_size > bs.ReadSize() - bs.read_ptr) {
       bs.read_ptr -= sizeof(uint64_t);
       throw Error {Error::INVALID_READ};
     }
-    output = bs.str_value.substr(bs.read_ptr, string_size);
+    output.assign(bs.ReadData() + bs.read_ptr, string_size);
     bs.read_ptr += string_size;
     return bs;
   }
@@ -152,6 +203,47 @@ DeserializeTuple(ByteStream& bs,  // NOLINT
   DeserializeTuple(bs, output, std::index_sequence<I+1>());
 }
 
+// Decodes the payload directly into the alternative `index`, which is
+// selected (default constructed) only if it isn't already.
+template<std::size_t index, typename... Ts>
+void DeserializeVariantAlternative(ByteStream& bs,  // NOLINT
+                                   quick::variant<Ts...>& output) {  // NOLINT
+  bs >> output.template at<index>();
+}
+
+template<typename... Ts, std::size_t... index>
+void DeserializeVariant(ByteStream& bs,  // NOLINT
+                        quick::variant<Ts...>& output,  // NOLINT
+                        uint32_t selected_type,
+                        std::index_sequence<index...>) {
+  using Function = void (*)(ByteStream&, quick::variant<Ts...>&);
+  static constexpr Function kDeserialize[] = {
+    &DeserializeVariantAlternative<index, Ts...>...};
+  kDeserialize[selected_type](bs, output);
+}
+
+#if __cplusplus >= 201703L
+template<std::size_t index, typename... Ts>
+void DeserializeStdVariantAlternative(ByteStream& bs,  // NOLINT
+                                      std::variant<Ts...>& output) {  // NOLINT
+  if (output.index() != index) {
+    output.template emplace<index>();
+  }
+  bs >> std::get<index>(output);
+}
+
+template<typename... Ts, std::size_t... index>
+void DeserializeStdVariant(ByteStream& bs,  // NOLINT
+                           std::variant<Ts...>& output,  // NOLINT
+                           uint32_t selected_type,
+                           std::index_sequence<index...>) {
+  using Function = void (*)(ByteStream&, std::variant<Ts...>&);
+  static constexpr Function kDeserialize[] = {
+    &DeserializeStdVariantAlternative<index, Ts...>...};
+  kDeserialize[selected_type](bs, output);
+}
+#endif
+
 template<typename MapType>
 ByteStream& SerializeMap(ByteStream& bs, const MapType& input) {  // NOLINT
   bs << static_cast<uint64_t>(input.size());
@@ -188,6 +280,57 @@ ByteStream& operator>>(ByteStream& bs, std::pair<T1, T2>& output) {
   return bs;
 }
 
+// Encoded as the selected type (uint32_t, sizeof...(Ts) if uninitialized)
+// followed by the selected alternative.
+template<typename... Ts>
+ByteStream& operator<<(ByteStream& bs, const quick::variant<Ts...>& input) {
+  bs << static_cast<uint32_t>(input.selected_type());
+  if (input.initialized()) {
+    quick::visit([&bs](const auto& value) { bs << value; }, input);
+  }
+  return bs;
+}
+
+template<typename... Ts>
+ByteStream& operator>>(ByteStream& bs, quick::variant<Ts...>& output) {
+  uint32_t selected_type;
+  bs >> selected_type;
+  if (selected_type == sizeof...(Ts)) {
+    output.clear();
+  } else if (selected_type > sizeof...(Ts)) {
+    throw ByteStream::Error {ByteStream::Error::INVALID_READ};
+  } else {
+    detail::DeserializeVariant(bs, output, selected_type,
+                               std::index_sequence_for<Ts...>());
+  }
+  return bs;
+}
+
+#if __cplusplus >= 201703L
+// Encoded same as quick::variant. A valueless variant can't be decoded.
+template<typename... Ts>
+ByteStream& operator<<(ByteStream& bs, const std::variant<Ts...>& input) {
+  if (input.valueless_by_exception()) {
+    return bs << static_cast<uint32_t>(sizeof...(Ts));
+  }
+  bs << static_cast<uint32_t>(input.index());
+  std::visit([&bs](const auto& value) { bs << value; }, input);
+  return bs;
+}
+
+template<typename... Ts>
+ByteStream& operator>>(ByteStream& bs, std::variant<Ts...>& output) {
+  uint32_t selected_type;
+  bs >> selected_type;
+  if (selected_type >= sizeof...(Ts)) {
+    throw ByteStream::Error {ByteStream::Error::INVALID_READ};
+  }
+  detail::DeserializeStdVariant(bs, output, selected_type,
+                                std::index_sequence_for<Ts...>());
+  return bs;
+}
+#endif
+
 template<typename T>
 std::enable_if_t<
   std::is_same<void,
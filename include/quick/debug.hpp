@@ -45,20 +45,370 @@
 #include <sstream>
 #include <tuple>
 #include <list>
+#include <limits>
+#include <locale>
+#include <memory>
+#include <streambuf>
 
 #include <quick/debug_stream.hpp>
 
 namespace quick {
 namespace detail {
 
+// Slots of std::ostream's extensible storage (std::ios_base::iword/pword),
+// holding the DebugLimits of a stream and the state of an ongoing print.
+struct OstreamDebugSlots {
+  int max_container_size = std::ios_base::xalloc();
+  int max_depth = std::ios_base::xalloc();
+  int max_output_size = std::ios_base::xalloc();
+  int nesting = std::ios_base::xalloc();
+  int limited_buffer = std::ios_base::xalloc();
+};
+
+inline const OstreamDebugSlots& GetOstreamDebugSlots() {
+  static const OstreamDebugSlots slots;
+  return slots;
+}
+
+// Limits are stored as (value + 1), so that the default iword value 0 means
+// unlimited.
+inline long EncodeDebugLimit(std::size_t value) {  // NOLINT
+  constexpr auto kMaxEncodable = std::numeric_limits<long>::max();  // NOLINT
+  if (value >= static_cast<std::size_t>(kMaxEncodable)) {
+    return 0;
+  }
+  return static_cast<long>(value) + 1;  // NOLINT
+}
+
+inline std::size_t DecodeDebugLimit(long value) {  // NOLINT
+  if (value <= 0) {
+    return std::numeric_limits<std::size_t>::max();
+  }
+  return static_cast<std::size_t>(value - 1);
+}
+
+// Forwards up to `limit` bytes to `target` and drops the rest, marking the
+// cut with " ... (truncated)".
+class LimitedStreamBuf: public std::streambuf {
+ public:
+  LimitedStreamBuf(std::streambuf* target, std::size_t limit)
+      : target_(target), remaining_(limit) {}
+
+  bool truncated() const {
+    return truncated_;
+  }
+
+  std::size_t remaining() const {
+    return remaining_;
+  }
+
+ protected:
+  std::streamsize xsputn(const char* data, std::streamsize size) override {
+    std::streamsize admitted = size;
+    if (static_cast<std::size_t>(size) > remaining_) {
+      admitted = static_cast<std::streamsize>(remaining_);
+    }
+    if (admitted > 0 && target_->sputn(data, admitted) != admitted) {
+      return 0;
+    }
+    remaining_ -= admitted;
+    if (admitted < size && not truncated_) {
+      truncated_ = true;
+      const char marker[] = " ... (truncated)";
+      target_->sputn(marker, sizeof(marker) - 1);
+    }
+    // Dropped bytes are reported as written, to keep the stream in good state.
+    return size;
+  }
+
+  int_type overflow(int_type c) override {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+      return traits_type::not_eof(c);
+    }
+    char ch = traits_type::to_char_type(c);
+    return (xsputn(&ch, 1) == 1) ? c : traits_type::eof();
+  }
+
+  int sync() override {
+    return target_->pubsync();
+  }
+
+ private:
+  std::streambuf* target_;
+  std::size_t remaining_;
+  bool truncated_ = false;
+};
+
+// Tracks the nesting of quick's printers on `os`. The outermost scope applies
+// max_output_size by routing `os` through a LimitedStreamBuf.
+class OstreamPrintScope {
+ public:
+  explicit OstreamPrintScope(std::ostream& os);
+  ~OstreamPrintScope();
+  OstreamPrintScope(const OstreamPrintScope&) = delete;
+  OstreamPrintScope& operator=(const OstreamPrintScope&) = delete;
+
+  bool exceeds_depth() const {
+    return nesting_ >= limits_.max_depth;
+  }
+
+  std::size_t max_container_size() const {
+    return limits_.max_container_size;
+  }
+
+  bool truncated() const {
+    const auto* buffer = static_cast<const LimitedStreamBuf*>(
+        os_.pword(GetOstreamDebugSlots().limited_buffer));
+    return buffer != nullptr && buffer->truncated();
+  }
+
+ private:
+  std::ostream& os_;
+  std::size_t nesting_;
+  DebugLimits limits_;
+  std::unique_ptr<LimitedStreamBuf> limited_buffer_;
+  std::streambuf* original_buffer_ = nullptr;
+};
+
+template<typename T>
+using IsOstreamDefinedForPair = decltype(
+      std::operator<<(std::declval<std::ostream&>(), std::declval<const T&>()));
+
+// Fast path of the printers below: values made only of arithmetic types,
+// std::string and the std containers handled here are rendered into a single
+// buffer, which is written with one `os.write`, instead of going through
+// `ostream::operator<<` (sentry and virtual dispatch) for every token.
+// User-defined types always take the generic path, since they might have
+// their own `operator<<`.
+// FastPrinter<T>::value tells if T can be rendered this way.
+template<typename T, typename = void>
+struct FastPrinter: std::false_type {};
+
+template<typename T>
+struct FastPrinter<T, std::enable_if_t<(std::is_integral<T>::value &&
+                                        sizeof(T) > 1 &&
+                                        not std::is_same<T, wchar_t>::value &&
+                                        not std::is_same<T, char16_t>::value &&
+                                        not std::is_same<T, char32_t>::value)>>
+    : std::true_type {
+  static void Append(std::string* output, T input) {
+    char tmp[24];
+    char* end = tmp + sizeof(tmp);
+    char* begin = FormatIntegerBackward(input, end);
+    output->append(begin, end - begin);
+  }
+};
+
+// std::ostream prints all the single byte integers (except bool) as
+// characters.
+template<typename T>
+struct FastPrinter<T, std::enable_if_t<(std::is_integral<T>::value &&
+                                        sizeof(T) == 1 &&
+                                        not std::is_same<T, bool>::value)>>
+    : std::true_type {
+  static void Append(std::string* output, T input) {
+    output->push_back(static_cast<char>(input));
+  }
+};
+
+template<>
+struct FastPrinter<bool>: std::true_type {
+  static void Append(std::string* output, bool input) {
+    output->push_back(input ? '1' : '0');
+  }
+};
+
+template<typename T>
+struct FastPrinter<T, std::enable_if_t<std::is_floating_point<T>::value>>
+    : std::true_type {
+  static void Append(std::string* output, T input) {
+    using U = std::conditional_t<std::is_same<T, long double>::value,
+                                 long double,
+                                 double>;
+    char tmp[64];
+    output->append(tmp, FormatFloat(static_cast<U>(input), tmp));
+  }
+};
+
+template<>
+struct FastPrinter<std::string>: std::true_type {
+  static void Append(std::string* output, const std::string& input) {
+    output->append(input);
+  }
+};
+
+template<typename Container>
+struct FastSequencePrinter
+    : std::integral_constant<
+          bool, FastPrinter<typename Container::value_type>::value> {
+  static void Append(std::string* output, const Container& input) {
+    output->push_back('[');
+    bool first = true;
+    for (auto& item : input) {
+      if (not first) {
+        output->append(", ", 2);
+      }
+      first = false;
+      FastPrinter<typename Container::value_type>::Append(output, item);
+    }
+    output->push_back(']');
+  }
+};
+
+template<typename MapContainer>
+struct FastMapPrinter
+    : std::integral_constant<
+          bool, (FastPrinter<typename MapContainer::key_type>::value &&
+                 FastPrinter<typename MapContainer::mapped_type>::value)> {
+  static void Append(std::string* output, const MapContainer& input) {
+    output->push_back('{');
+    bool first = true;
+    for (auto& item : input) {
+      if (not first) {
+        output->append(", ", 2);
+      }
+      first = false;
+      FastPrinter<typename MapContainer::key_type>::Append(output,
+                                                           item.first);
+      output->append(": ", 2);
+      FastPrinter<typename MapContainer::mapped_type>::Append(output,
+                                                              item.second);
+    }
+    output->push_back('}');
+  }
+};
+
+template<typename... Ts>
+struct FastPrinter<std::vector<Ts...>>
+    : FastSequencePrinter<std::vector<Ts...>> {};
+
+template<typename... Ts>
+struct FastPrinter<std::list<Ts...>>: FastSequencePrinter<std::list<Ts...>> {};
+
+template<typename... Ts>
+struct FastPrinter<std::set<Ts...>>: FastSequencePrinter<std::set<Ts...>> {};
+
+template<typename... Ts>
+struct FastPrinter<std::unordered_set<Ts...>>
+    : FastSequencePrinter<std::unordered_set<Ts...>> {};
+
+template<typename... Ts>
+struct FastPrinter<std::map<Ts...>>: FastMapPrinter<std::map<Ts...>> {};
+
+template<typename... Ts>
+struct FastPrinter<std::unordered_map<Ts...>>
+    : FastMapPrinter<std::unordered_map<Ts...>> {};
+
+// Only if quick's printer is the one used for this pair.
+template<typename T1, typename T2>
+struct FastPrinter<std::pair<T1, T2>,
+                   std::enable_if_t<not test_specialization<
+                                          IsOstreamDefinedForPair,
+                                          std::pair<T1, T2>>::value>>
+    : std::integral_constant<bool, (FastPrinter<T1>::value &&
+                                    FastPrinter<T2>::value)> {
+  static void Append(std::string* output, const std::pair<T1, T2>& input) {
+    output->push_back('(');
+    FastPrinter<T1>::Append(output, input.first);
+    output->append(", ", 2);
+    FastPrinter<T2>::Append(output, input.second);
+    output->push_back(')');
+  }
+};
+
+template<typename... Ts>
+struct FastPrinter<std::tuple<Ts...>>
+    : std::integral_constant<bool, std::is_same<
+                                  std::integer_sequence<
+                                      bool, true, FastPrinter<Ts>::value...>,
+                                  std::integer_sequence<
+                                      bool, FastPrinter<Ts>::value...,
+                                      true>>::value> {
+  static void Append(std::string* output, const std::tuple<Ts...>& input) {
+    output->push_back('(');
+    AppendElements(output, input, std::index_sequence_for<Ts...>());
+    output->push_back(')');
+  }
+
+ private:
+  template<std::size_t... index>
+  static void AppendElements(std::string* output,
+                             const std::tuple<Ts...>& input,
+                             std::index_sequence<index...>) {
+    using expander = int[];
+    (void) expander {0, ((void) (
+        (index == 0 ? void() : (void) output->append(", ", 2)),
+        FastPrinter<std::tuple_element_t<index, std::tuple<Ts...>>>::Append(
+            output, std::get<index>(input))), 0)...};
+  }
+};
+
+// The fast path renders exactly what the generic path would, as long as `os`
+// has the default formatting and no DebugLimits.
+inline bool CanPrintFast(std::ostream& os) {
+  const auto& slots = GetOstreamDebugSlots();
+  // skipws and unitbuf (set on std::cerr) don't affect the rendering.
+  auto flags = os.flags() & ~(std::ios_base::skipws | std::ios_base::unitbuf);
+  return flags == std::ios_base::dec &&
+         os.precision() == 6 &&
+         os.width() == 0 &&
+         os.iword(slots.max_container_size) == 0 &&
+         os.iword(slots.max_depth) == 0 &&
+         os.iword(slots.max_output_size) == 0 &&
+         os.getloc() == std::locale::classic();
+}
+
+template<typename T>
+bool TryPrintFast(std::ostream&, const T&, std::false_type) {
+  return false;
+}
+
+template<typename T>
+bool TryPrintFast(std::ostream& os, const T& input, std::true_type) {
+  if (not CanPrintFast(os)) {
+    return false;
+  }
+  // Rendering doesn't run any user code, so the buffer can't be reentered.
+  static thread_local std::string buffer;
+  buffer.clear();
+  FastPrinter<T>::Append(&buffer, input);
+  os.write(buffer.data(), buffer.size());
+  if (buffer.capacity() > (1 << 20)) {
+    std::string().swap(buffer);
+  }
+  return true;
+}
+
+// Prints `input` with the fast path if possible. Returns false, without
+// writing anything, if the generic path is needed.
+template<typename T>
+bool TryPrintFast(std::ostream& os, const T& input) {
+  return TryPrintFast(os, input,
+                      std::integral_constant<bool, FastPrinter<T>::value>());
+}
+
 // Assumes `ostream << element` is defined for elements of input.
 template<typename Container>
 std::ostream& PrintContainer(std::ostream& os, const Container& input) {
+  if (TryPrintFast(os, input)) {
+    return os;
+  }
+  OstreamPrintScope scope(os);
+  if (input.size() > 0 && scope.exceeds_depth()) {
+    return os << "[...]";
+  }
   os << "[";
-  bool is_first_item = true;
+  std::size_t num_printed = 0;
   for (auto& item : input) {
-    os << (is_first_item ? "" : ", ") << item;
-    is_first_item = false;
+    if (num_printed == scope.max_container_size() || scope.truncated()) {
+      break;
+    }
+    os << (num_printed == 0 ? "" : ", ") << item;
+    num_printed++;
+  }
+  if (num_printed < input.size() && not scope.truncated()) {
+    os << (num_printed == 0 ? "" : ", ")
+       << "... (" << (input.size() - num_printed) << " more)";
   }
   os << "]";
   return os;
@@ -68,11 +418,25 @@ std::ostream& PrintContainer(std::ostream& os, const Container& input) {
 // input map.
 template<typename MapContainer>
 std::ostream& PrintMap(std::ostream& os, const MapContainer& input) {
+  if (TryPrintFast(os, input)) {
+    return os;
+  }
+  OstreamPrintScope scope(os);
+  if (input.size() > 0 && scope.exceeds_depth()) {
+    return os << "{...}";
+  }
   os << "{";
-  bool is_first_item = true;
+  std::size_t num_printed = 0;
   for (auto& item : input) {
-    os << (is_first_item ? "" : ", ") << item.first << ": " << item.second;
-    is_first_item = false;
+    if (num_printed == scope.max_container_size() || scope.truncated()) {
+      break;
+    }
+    os << (num_printed == 0 ? "" : ", ") << item.first << ": " << item.second;
+    num_printed++;
+  }
+  if (num_printed < input.size() && not scope.truncated()) {
+    os << (num_printed == 0 ? "" : ", ")
+       << "... (" << (input.size() - num_printed) << " more)";
   }
   os << "}";
   return os;
@@ -96,13 +460,34 @@ inline void PrintTupleImpl(std::ostream& os,
 
 template<typename... Ts>
 void PrintTuple(std::ostream& os, const std::tuple<Ts...>& input) {
-  os << "(";
+  if (TryPrintFast(os, input)) {
+    return;
+  }
+  OstreamPrintScope scope(os);
   constexpr std::size_t num_elements
                             = std::tuple_size<std::tuple<Ts...>>::value;
+  if (num_elements > 0 && scope.exceeds_depth()) {
+    os << "(...)";
+    return;
+  }
+  os << "(";
   PrintTupleImpl(os, input, std::make_index_sequence<num_elements>());
   os << ")";
 }
 
+template<typename T1, typename T2>
+void PrintPair(std::ostream& os, const std::pair<T1, T2>& input) {
+  if (TryPrintFast(os, input)) {
+    return;
+  }
+  OstreamPrintScope scope(os);
+  if (scope.exceeds_depth()) {
+    os << "(...)";
+    return;
+  }
+  os << "(" << input.first << ", " << input.second << ")";
+}
+
 
 
 // In case of success: output type is an instance of std::true_type
@@ -122,11 +507,73 @@ using HasDebugStream = std::is_same<void,
                                       std::declval<const T&>().DebugStream(
                                         std::declval<quick::DebugStream&>()))>;
 
-template<typename T>
-using IsOstreamDefinedForPair = decltype(
-      std::operator<<(std::declval<std::ostream&>(), std::declval<const T&>()));
+}  // namespace detail
 
+// Sets the limits applied by quick's std::ostream printers on `os`, ex:
+// `quick::SetDebugLimits(std::cerr, limits); std::cerr << huge_vector;`
+inline void SetDebugLimits(std::ostream& os, const DebugLimits& limits) {
+  const auto& slots = detail::GetOstreamDebugSlots();
+  os.iword(slots.max_container_size)
+      = detail::EncodeDebugLimit(limits.max_container_size);
+  os.iword(slots.max_depth) = detail::EncodeDebugLimit(limits.max_depth);
+  os.iword(slots.max_output_size)
+      = detail::EncodeDebugLimit(limits.max_output_size);
+}
+
+inline DebugLimits GetDebugLimits(std::ostream& os) {
+  const auto& slots = detail::GetOstreamDebugSlots();
+  DebugLimits limits;
+  limits.max_container_size
+      = detail::DecodeDebugLimit(os.iword(slots.max_container_size));
+  limits.max_depth = detail::DecodeDebugLimit(os.iword(slots.max_depth));
+  limits.max_output_size
+      = detail::DecodeDebugLimit(os.iword(slots.max_output_size));
+  return limits;
+}
+
+namespace detail {
+
+// Limits for a DebugStream rendering a hook inside quick's printers on `os`,
+// continuing from the depth and the output budget already used there.
+inline void InheritOstreamLimits(std::ostream& os,
+                                 quick::DebugStream& ds) {  // NOLINT
+  const auto& slots = GetOstreamDebugSlots();
+  DebugLimits limits = GetDebugLimits(os);
+  const auto* buffer = static_cast<const LimitedStreamBuf*>(
+      os.pword(slots.limited_buffer));
+  if (buffer != nullptr) {
+    limits.max_output_size = buffer->remaining();
+  }
+  ds.SetLimits(limits);
+  ds.nesting = static_cast<uint32_t>(os.iword(slots.nesting));
+}
 
+inline OstreamPrintScope::OstreamPrintScope(std::ostream& os)
+    : os_(os), limits_(GetDebugLimits(os)) {
+  const auto& slots = GetOstreamDebugSlots();
+  nesting_ = static_cast<std::size_t>(os.iword(slots.nesting)++);
+  if (nesting_ == 0 &&
+      limits_.max_output_size != std::numeric_limits<std::size_t>::max()) {
+    // Swapping the rdbuf clears the state flags, hence restoring them.
+    auto state = os.rdstate();
+    limited_buffer_.reset(new LimitedStreamBuf(os.rdbuf(),
+                                               limits_.max_output_size));
+    original_buffer_ = os.rdbuf(limited_buffer_.get());
+    os.clear(state);
+    os.pword(slots.limited_buffer) = limited_buffer_.get();
+  }
+}
+
+inline OstreamPrintScope::~OstreamPrintScope() {
+  const auto& slots = GetOstreamDebugSlots();
+  os_.iword(slots.nesting)--;
+  if (limited_buffer_ != nullptr) {
+    auto state = os_.rdstate();
+    os_.rdbuf(original_buffer_);
+    os_.clear(state);
+    os_.pword(slots.limited_buffer) = nullptr;
+  }
+}
 
 }  // namespace detail
 
@@ -155,7 +602,12 @@ operator<<(ostream& os, const T& input) {
 template<typename T>
 std::enable_if_t<quick::detail::HasDebugStream<T>::value, ostream>&
 operator<<(ostream& os, const T& input) {
-  os << quick::DebugStream(input).str();
+  // Streams the rendering in chunks instead of materializing it first.
+  quick::DebugStream ds;
+  quick::detail::InheritOstreamLimits(os, ds);
+  ds.SetSink(quick::OstreamSink(os));
+  ds << input;
+  ds.Flush();
   return os;
 }
 
@@ -165,7 +617,7 @@ std::enable_if_t<(quick::is_specialization<T, std::pair>::value &&
                                  T>::value)
 , ostream>&
 operator<<(ostream& os, const T& input) {
-  os << "(" << input.first << ", " << input.second << ")";
+  quick::detail::PrintPair(os, input);
   return os;
 }
 
@@ -0,0 +1,653 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#ifndef QUICK_DEBUG_DIFF_HPP_
+#define QUICK_DEBUG_DIFF_HPP_
+
+// Structural diff of two objects of the same type, rendering only the paths
+// which differ, one line each:
+//   ~ $[3].first: 5 -> 6        (value changed)
+//   - $[abc]: [1, 2]            (only in the first object)
+//   + $[10]: x                  (only in the second object)
+//
+// std containers, pairs and tuples are walked element by element, in a
+// single pass. Equal elements are skipped without being rendered, and map
+// keys are rendered only into the paths of the differences. Sequences first skip their
+// common prefix and suffix, so an insertion or deletion is reported once
+// instead of shifting every following element. Unordered containers are
+// matched by hash lookups, and their differences are sorted by the rendering
+// of the key, independently of the iteration order. Any other type
+// (including the ones having a DebugStream hook) is compared as a whole, with
+// `==` if defined, otherwise with quick::hash (a different hash proves the
+// difference, ex: from GetHash(), see quick/hash.hpp) and then its rendering.
+//
+// Sample usage:
+// std::cout << qk::DebugDiff(old_snapshot, new_snapshot);
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "quick/debug_stream.hpp"
+#include "quick/hash.hpp"
+#include "quick/type_traits.hpp"
+
+namespace quick {
+namespace detail {
+
+struct DiffLeafTag {};
+struct DiffSequenceTag {};
+struct DiffOrderedMapTag {};
+struct DiffUnorderedMapTag {};
+struct DiffOrderedSetTag {};
+struct DiffUnorderedSetTag {};
+struct DiffPairTag {};
+struct DiffTupleTag {};
+
+template<typename T>
+using DiffTag = std::conditional_t<
+    (is_specialization<T, std::vector>::value ||
+     is_specialization<T, std::list>::value ||
+     is_specialization<T, std::deque>::value ||
+     IsStdArray<T>::value), DiffSequenceTag,
+    std::conditional_t<
+    is_specialization<T, std::map>::value, DiffOrderedMapTag,
+    std::conditional_t<
+    is_specialization<T, std::unordered_map>::value, DiffUnorderedMapTag,
+    std::conditional_t<
+    is_specialization<T, std::set>::value, DiffOrderedSetTag,
+    std::conditional_t<
+    is_specialization<T, std::unordered_set>::value, DiffUnorderedSetTag,
+    std::conditional_t<
+    is_specialization<T, std::pair>::value, DiffPairTag,
+    std::conditional_t<
+    is_specialization<T, std::tuple>::value, DiffTupleTag,
+    DiffLeafTag>>>>>>>;
+
+template<typename T>
+using HasEqualOperator = std::is_convertible<
+    decltype(std::declval<const T&>() == std::declval<const T&>()), bool>;
+
+template<typename T>
+using HasQuickHash = std::is_convertible<
+    decltype(quick::hash<T>()(std::declval<const T&>())), std::size_t>;
+
+class DebugDiffer {
+ public:
+  explicit DebugDiffer(DebugStream* ds) : ds_(ds), path_("$") {}
+
+  // Writes the differences, returns true if there is any.
+  template<typename T>
+  bool Diff(const T& a, const T& b) {
+    return Diff(a, b, DiffTag<T>());
+  }
+
+  // True if `a` and `b` have no difference.
+  template<typename T>
+  bool Same(const T& a, const T& b) {
+    return Same(a, b, DiffTag<T>());
+  }
+
+  std::size_t num_differences() const {
+    return num_differences_;
+  }
+
+ private:
+  // Path components are rendered into `path_` only when a difference is
+  // written, hence the keys of the equal map entries are never rendered.
+  struct PathComponent {
+    const void* data;
+    std::size_t index;
+    void (*render)(const PathComponent& component, std::string* path);
+    // Size of `path_` before the component, once rendered.
+    std::size_t offset;
+  };
+
+  // Pushes a path component, which is removed at the end of the scope.
+  class PathScope {
+   public:
+    PathScope(DebugDiffer* differ, const PathComponent& component)
+        : differ_(differ) {
+      differ_->components_.push_back(component);
+    }
+    ~PathScope() {
+      auto& components = differ_->components_;
+      if (differ_->num_rendered_ == components.size()) {
+        differ_->path_.resize(components.back().offset);
+        differ_->num_rendered_--;
+      }
+      components.pop_back();
+    }
+    PathScope(const PathScope&) = delete;
+    PathScope& operator=(const PathScope&) = delete;
+
+   private:
+    DebugDiffer* differ_;
+  };
+
+  static PathComponent IndexComponent(std::size_t index) {
+    return {nullptr, index, [](const PathComponent& component,
+                               std::string* path) {
+      path->append("[" + std::to_string(component.index) + "]");
+    }, 0};
+  }
+
+  // `text` must outlive the component.
+  static PathComponent TextComponent(const char* text) {
+    return {text, 0, [](const PathComponent& component, std::string* path) {
+      path->append(static_cast<const char*>(component.data));
+    }, 0};
+  }
+
+  // `key` must outlive the component.
+  template<typename K>
+  static PathComponent KeyComponent(const K& key) {
+    return {&key, 0, [](const PathComponent& component, std::string* path) {
+      path->append(RenderKey(*static_cast<const K*>(component.data)));
+    }, 0};
+  }
+
+  template<typename K>
+  static std::string RenderKey(const K& key) {
+    DebugStream key_ds;
+    key_ds.SetInline(true);
+    key_ds.Append('[') << key;
+    key_ds.Append(']');
+    return std::move(key_ds).str();
+  }
+
+  // Writes the differences into `lines` instead, to be written later with
+  // WriteDetached(), or dropped. Returns the number of differences.
+  template<typename T>
+  std::size_t DiffDetached(const T& a, const T& b, std::string* lines) {
+    DebugStream detached;
+    detached.is_inline = ds_->is_inline;
+    detached.indentation_space = ds_->indentation_space;
+    detached.depth = ds_->depth;
+    detached.nesting = ds_->nesting;
+    detached.is_json = ds_->is_json;
+    detached.limits = ds_->limits;
+    DebugStream* ds = ds_;
+    std::size_t num_differences = num_differences_;
+    ds_ = &detached;
+    Diff(a, b);
+    ds_ = ds;
+    std::swap(num_differences, num_differences_);
+    detached.SwapBuffer(*lines);
+    return num_differences - num_differences_;
+  }
+
+  void WriteDetached(const std::string& lines, std::size_t num_differences) {
+    ds_->Append(lines.data(), lines.size());
+    num_differences_ += num_differences;
+  }
+
+  template<typename T>
+  void Render(const T& value) {
+    DebugStream::SetInlineForThisScope inline_scope(true, &ds_->is_inline);
+    (*ds_) << value;
+  }
+
+  void StartLine(char marker) {
+    num_differences_++;
+    for (; num_rendered_ < components_.size(); num_rendered_++) {
+      auto& component = components_[num_rendered_];
+      component.offset = path_.size();
+      component.render(component, &path_);
+    }
+    ds_->Append(marker).Append(' ').Append(path_.data(), path_.size());
+    ds_->Append(": ");
+  }
+
+  template<typename T>
+  void Removed(const T& value) {
+    StartLine('-');
+    Render(value);
+    ds_->PrintChar('\n');
+  }
+
+  template<typename T>
+  void Added(const T& value) {
+    StartLine('+');
+    Render(value);
+    ds_->PrintChar('\n');
+  }
+
+  template<typename T>
+  void Changed(const T& a, const T& b) {
+    StartLine('~');
+    Render(a);
+    ds_->Append(" -> ");
+    Render(b);
+    ds_->PrintChar('\n');
+  }
+
+  // Leaves.
+
+  template<typename T>
+  bool Diff(const T& a, const T& b, DiffLeafTag) {
+    if (SameLeaf(a, b)) {
+      return false;
+    }
+    Changed(a, b);
+    return true;
+  }
+
+  template<typename T>
+  bool Same(const T& a, const T& b, DiffLeafTag) {
+    return SameLeaf(a, b);
+  }
+
+  template<typename T>
+  std::enable_if_t<HasEqualOperator<T>::value, bool>
+  SameLeaf(const T& a, const T& b) {
+    return a == b;
+  }
+
+  template<typename T>
+  std::enable_if_t<not specialize_if_can<std::false_type,
+                                         HasEqualOperator, T>::value, bool>
+  SameLeaf(const T& a, const T& b) {
+    // Different hashes prove the difference without rendering.
+    if (not SameHash(a, b)) {
+      return false;
+    }
+    DebugStream a_ds, b_ds;
+    a_ds.SetInline(true) << a;
+    b_ds.SetInline(true) << b;
+    return a_ds.str() == b_ds.str();
+  }
+
+  template<typename T>
+  std::enable_if_t<HasQuickHash<T>::value, bool>
+  SameHash(const T& a, const T& b) {
+    quick::hash<T> hasher;
+    return hasher(a) == hasher(b);
+  }
+
+  template<typename T>
+  std::enable_if_t<not specialize_if_can<std::false_type,
+                                         HasQuickHash, T>::value, bool>
+  SameHash(const T&, const T&) {
+    return true;
+  }
+
+  // Sequences.
+
+  // Each element is walked once, except around the first difference from the
+  // end (when looking for the common suffix), where Same() stops early.
+  template<typename T>
+  bool Diff(const T& a, const T& b, DiffSequenceTag) {
+    // Iterators rather than pointers, for proxy references (vector<bool>).
+    std::vector<typename T::const_iterator> a_items, b_items;
+    a_items.reserve(a.size());
+    b_items.reserve(b.size());
+    for (auto it = a.begin(); it != a.end(); ++it) {
+      a_items.push_back(it);
+    }
+    for (auto it = b.begin(); it != b.end(); ++it) {
+      b_items.push_back(it);
+    }
+    std::size_t a_size = a_items.size(), b_size = b_items.size();
+    std::size_t common = std::min(a_size, b_size);
+    // The elements of the common prefix are diffed right away. The first
+    // different one is part of the changed range unless the sizes differ,
+    // in which case it may turn out to be shifted by the common suffix,
+    // hence its differences are kept aside until then.
+    std::size_t prefix = 0, suffix = 0;
+    std::string first_lines;
+    std::size_t num_first = 0;
+    for (; prefix < common; prefix++) {
+      PathScope scope(this, IndexComponent(prefix));
+      if (a_size == b_size) {
+        if (Diff(*a_items[prefix], *b_items[prefix])) {
+          break;
+        }
+      } else if ((num_first = DiffDetached(*a_items[prefix], *b_items[prefix],
+                                           &first_lines)) > 0) {
+        break;
+      }
+    }
+    if (prefix == common && a_size == b_size) {
+      return false;
+    }
+    // The first different element isn't part of the suffix, if paired.
+    std::size_t max_suffix = common - prefix;
+    if (a_size == b_size) {
+      max_suffix--;
+    }
+    while (suffix < max_suffix &&
+           Same(*a_items[a_size - 1 - suffix],
+                *b_items[b_size - 1 - suffix])) {
+      suffix++;
+    }
+    std::size_t i = prefix;
+    if (a_size == b_size) {
+      i++;
+    } else if (prefix < common - suffix) {
+      WriteDetached(first_lines, num_first);
+      i++;
+    }
+    for (; i < common - suffix; i++) {
+      PathScope scope(this, IndexComponent(i));
+      Diff(*a_items[i], *b_items[i]);
+    }
+    for (std::size_t j = i; j < a_size - suffix; j++) {
+      PathScope scope(this, IndexComponent(j));
+      Removed(*a_items[j]);
+    }
+    for (std::size_t j = i; j < b_size - suffix; j++) {
+      PathScope scope(this, IndexComponent(j));
+      Added(*b_items[j]);
+    }
+    return true;
+  }
+
+  template<typename T>
+  bool Same(const T& a, const T& b, DiffSequenceTag) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    auto b_it = b.begin();
+    for (auto a_it = a.begin(); a_it != a.end(); ++a_it, ++b_it) {
+      if (not Same(*a_it, *b_it)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Maps and sets, ordered ones are merged in key order.
+
+  template<typename T>
+  bool Diff(const T& a, const T& b, DiffOrderedMapTag) {
+    auto less = a.key_comp();
+    auto a_it = a.begin(), b_it = b.begin();
+    bool differ = false;
+    while (a_it != a.end() || b_it != b.end()) {
+      bool added = (a_it == a.end() ||
+                    (b_it != b.end() && less(b_it->first, a_it->first)));
+      PathScope scope(this, KeyComponent(added ? b_it->first : a_it->first));
+      if (b_it == b.end() ||
+          (a_it != a.end() && less(a_it->first, b_it->first))) {
+        Removed(a_it->second);
+        differ = true;
+        ++a_it;
+      } else if (added) {
+        Added(b_it->second);
+        differ = true;
+        ++b_it;
+      } else {
+        differ = Diff(a_it->second, b_it->second) || differ;
+        ++a_it;
+        ++b_it;
+      }
+    }
+    return differ;
+  }
+
+  template<typename T>
+  bool Same(const T& a, const T& b, DiffOrderedMapTag) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    auto less = a.key_comp();
+    auto b_it = b.begin();
+    for (auto& item : a) {
+      if (less(item.first, b_it->first) || less(b_it->first, item.first) ||
+          not Same(item.second, b_it->second)) {
+        return false;
+      }
+      ++b_it;
+    }
+    return true;
+  }
+
+  // A difference in an unordered container, emitted after sorting them by
+  // `component`, so that the output doesn't depend on the iteration order.
+  template<typename V>
+  struct UnorderedDifference {
+    std::string component;
+    const V* a;
+    const V* b;
+    // Rendered differences of `a` and `b`, if both are set.
+    std::string lines;
+    std::size_t num_differences;
+
+    bool operator<(const UnorderedDifference& other) const {
+      return component < other.component;
+    }
+  };
+
+  // The values of the common keys are diffed aside, before sorting.
+  template<typename T>
+  bool Diff(const T& a, const T& b, DiffUnorderedMapTag) {
+    using V = typename T::mapped_type;
+    std::vector<UnorderedDifference<V>> differences;
+    std::string lines;
+    for (auto& item : a) {
+      auto it = b.find(item.first);
+      if (it == b.end()) {
+        differences.push_back({RenderKey(item.first), &item.second,
+                               nullptr, std::string(), 0});
+        continue;
+      }
+      PathScope scope(this, KeyComponent(item.first));
+      std::size_t num_differences = DiffDetached(item.second, it->second,
+                                                 &lines);
+      if (num_differences > 0) {
+        differences.push_back({RenderKey(item.first), &item.second,
+                               &it->second, std::move(lines),
+                               num_differences});
+        lines.clear();
+      }
+    }
+    for (auto& item : b) {
+      if (a.find(item.first) == a.end()) {
+        differences.push_back({RenderKey(item.first), nullptr,
+                               &item.second, std::string(), 0});
+      }
+    }
+    std::stable_sort(differences.begin(), differences.end());
+    for (auto& difference : differences) {
+      PathScope scope(this, TextComponent(difference.component.c_str()));
+      if (difference.b == nullptr) {
+        Removed(*difference.a);
+      } else if (difference.a == nullptr) {
+        Added(*difference.b);
+      } else {
+        WriteDetached(difference.lines, difference.num_differences);
+      }
+    }
+    return not differences.empty();
+  }
+
+  template<typename T>
+  bool Same(const T& a, const T& b, DiffUnorderedMapTag) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (auto& item : a) {
+      auto it = b.find(item.first);
+      if (it == b.end() || not Same(item.second, it->second)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template<typename T>
+  bool Diff(const T& a, const T& b, DiffOrderedSetTag) {
+    auto less = a.key_comp();
+    auto a_it = a.begin(), b_it = b.begin();
+    bool differ = false;
+    while (a_it != a.end() || b_it != b.end()) {
+      if (b_it == b.end() || (a_it != a.end() && less(*a_it, *b_it))) {
+        Removed(*(a_it++));
+        differ = true;
+      } else if (a_it == a.end() || less(*b_it, *a_it)) {
+        Added(*(b_it++));
+        differ = true;
+      } else {
+        ++a_it;
+        ++b_it;
+      }
+    }
+    return differ;
+  }
+
+  template<typename T>
+  bool Same(const T& a, const T& b, DiffOrderedSetTag) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    auto less = a.key_comp();
+    auto b_it = b.begin();
+    for (auto& item : a) {
+      if (less(item, *b_it) || less(*b_it, item)) {
+        return false;
+      }
+      ++b_it;
+    }
+    return true;
+  }
+
+  template<typename T>
+  bool Diff(const T& a, const T& b, DiffUnorderedSetTag) {
+    using E = typename T::value_type;
+    std::vector<UnorderedDifference<E>> differences;
+    for (auto& item : a) {
+      if (b.find(item) == b.end()) {
+        differences.push_back({RenderKey(item), &item, nullptr,
+                               std::string(), 0});
+      }
+    }
+    for (auto& item : b) {
+      if (a.find(item) == a.end()) {
+        differences.push_back({RenderKey(item), nullptr, &item,
+                               std::string(), 0});
+      }
+    }
+    std::stable_sort(differences.begin(), differences.end());
+    for (auto& difference : differences) {
+      if (difference.b == nullptr) {
+        Removed(*difference.a);
+      } else {
+        Added(*difference.b);
+      }
+    }
+    return not differences.empty();
+  }
+
+  template<typename T>
+  bool Same(const T& a, const T& b, DiffUnorderedSetTag) {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (auto& item : a) {
+      if (b.find(item) == b.end()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Pairs and tuples.
+
+  template<typename T>
+  bool Diff(const T& a, const T& b, DiffPairTag) {
+    bool differ;
+    {
+      PathScope scope(this, TextComponent(".first"));
+      differ = Diff(a.first, b.first);
+    }
+    PathScope scope(this, TextComponent(".second"));
+    return Diff(a.second, b.second) || differ;
+  }
+
+  template<typename T>
+  bool Same(const T& a, const T& b, DiffPairTag) {
+    return Same(a.first, b.first) && Same(a.second, b.second);
+  }
+
+  template<typename T>
+  bool Diff(const T& a, const T& b, DiffTupleTag) {
+    return DiffTuple(a, b,
+                     std::make_index_sequence<std::tuple_size<T>::value>());
+  }
+
+  template<typename T>
+  bool Same(const T& a, const T& b, DiffTupleTag) {
+    return SameTuple(a, b,
+                     std::make_index_sequence<std::tuple_size<T>::value>());
+  }
+
+  template<typename T, std::size_t... index>
+  bool DiffTuple(const T& a, const T& b, std::index_sequence<index...>) {
+    bool differ = false;
+    using expander = int[];
+    (void) expander {0, ((void) (
+        differ = DiffElement(index, std::get<index>(a), std::get<index>(b)) ||
+                 differ), 0)...};
+    return differ;
+  }
+
+  template<typename E>
+  bool DiffElement(std::size_t index, const E& a, const E& b) {
+    PathScope scope(this, IndexComponent(index));
+    return Diff(a, b);
+  }
+
+  template<typename T, std::size_t... index>
+  bool SameTuple(const T& a, const T& b, std::index_sequence<index...>) {
+    bool same = true;
+    using expander = int[];
+    (void) expander {0, ((void) (
+        same = same && Same(std::get<index>(a), std::get<index>(b))), 0)...};
+    return same;
+  }
+
+  DebugStream* ds_;
+  // Rendered path of the first `num_rendered_` components.
+  std::string path_;
+  std::vector<PathComponent> components_;
+  std::size_t num_rendered_ = 0;
+  std::size_t num_differences_ = 0;
+};
+
+}  // namespace detail
+
+// Writes the differences between `a` and `b` into `ds`, one line per
+// differing path. Returns the number of differences.
+template<typename T>
+std::size_t DebugDiff(const T& a, const T& b, DebugStream& ds) {  // NOLINT
+  detail::DebugDiffer differ(&ds);
+  differ.Diff(a, b);
+  return differ.num_differences();
+}
+
+// Returns the differences between `a` and `b`, empty if they are equal.
+template<typename T>
+std::string DebugDiff(const T& a, const T& b) {
+  DebugStream ds;
+  ds.SetInline(true);
+  DebugDiff(a, b, ds);
+  return std::move(ds).str();
+}
+
+}  // namespace quick
+
+namespace qk = quick;
+
+#endif  // QUICK_DEBUG_DIFF_HPP_
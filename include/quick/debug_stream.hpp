@@ -4,36 +4,174 @@
 #ifndef QUICK_DEBUG_STREAM_HPP_
 #define QUICK_DEBUG_STREAM_HPP_
 
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include <iostream>  // NOLINT
 #include <map>
 #include <utility>
 #include <vector>
 #include <set>
 #include <list>
+#include <deque>
+#include <array>
+#include <tuple>
 #include <unordered_set>
 #include <unordered_map>
-#include <sstream>
-#include <fstream>
 #include <string>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <cerrno>
+#include <cmath>
 
 #include <quick/type_traits.hpp>
 
-// ToDos()
-//  1. Implement DebugStream for std::tuple
+#if __cplusplus >= 201703L
+#include <optional>
+#include <variant>
+#endif
 
 
 namespace quick {
 
+template<typename... Ts> struct variant;
+
+namespace detail {
+
+// Writes the decimal representation of `value` ending at `end` and returns the
+// pointer to the first character. `end` must have at least 20 bytes before it.
+template<typename T>
+inline char* FormatUnsignedBackward(T value, char* end) {
+  static_assert(std::is_unsigned<T>::value, "");
+  do {
+    *(--end) = static_cast<char>('0' + (value % 10));
+    value /= 10;
+  } while (value != 0);
+  return end;
+}
+
+// Same as FormatUnsignedBackward, for any integer type. `end` must have at
+// least 21 bytes before it.
+template<typename T>
+inline char* FormatIntegerBackward(T value, char* end) {
+  using U = std::make_unsigned_t<T>;
+  if (value < 0) {
+    // Negating in the unsigned domain is well defined for the minimum value.
+    char* begin = FormatUnsignedBackward(
+                      static_cast<U>(U(0) - static_cast<U>(value)), end);
+    *(--begin) = '-';
+    return begin;
+  }
+  return FormatUnsignedBackward(static_cast<U>(value), end);
+}
+
+// Formats like std::ostream with the default flags, i.e. "%g" with precision
+// 6. Returns the number of characters written to `output`.
+inline std::size_t FormatFloat(double value, char (&output)[64]) {
+  return std::snprintf(output, sizeof(output), "%g", value);
+}
+
+inline std::size_t FormatFloat(long double value, char (&output)[64]) {
+  return std::snprintf(output, sizeof(output), "%Lg", value);
+}
+
+// Returns the length of the longest prefix which can be copied into a JSON
+// string as is, i.e. has no '"', '\\' or control character. Scans 16 bytes at
+// a time with SSE2, if available.
+inline std::size_t JsonSafePrefixSize(const char* data, std::size_t size) {
+  std::size_t i = 0;
+#ifdef __SSE2__
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i max_control = _mm_set1_epi8(0x1F);
+  for (; i + 16 <= size; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    // Unsigned (chunk <= 0x1F) is same as (min(chunk, 0x1F) == chunk).
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                     _mm_cmpeq_epi8(chunk, backslash)),
+        _mm_cmpeq_epi8(_mm_min_epu8(chunk, max_control), chunk));
+    int mask = _mm_movemask_epi8(special);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; i < size; i++) {
+    auto c = static_cast<unsigned char>(data[i]);
+    if (c < 0x20 || c == '"' || c == '\\') {
+      return i;
+    }
+  }
+  return size;
+}
+
+}  // namespace detail
+
+// Bounds the cost of rendering large objects. Containers longer than
+// `max_container_size` are printed as "[1, 2, ... (N more)]", containers nested
+// deeper than `max_depth` as "[...]", and the output is cut at
+// `max_output_size` bytes, followed by " ... (truncated)".
+struct DebugLimits {
+  std::size_t max_container_size = std::numeric_limits<std::size_t>::max();
+  std::size_t max_depth = std::numeric_limits<std::size_t>::max();
+  std::size_t max_output_size = std::numeric_limits<std::size_t>::max();
+};
+
 // Not Thread Safe
+//
+// Output is rendered into a contiguous std::string buffer. Plain text is
+// bulk-appended between newlines (located with memchr), and numbers are
+// formatted in place without going through std::ostream.
 class DebugStream {
  private:
   using string = std::string;
-  using ostringstream = std::ostringstream;
 
  public:
-  std::ostringstream oss;
   DebugStream() = default;
-  DebugStream(const DebugStream&) = default;
+
+  // The copy doesn't inherit the sink, so that the buffered output reaches
+  // the sink only once, from `other`.
+  DebugStream(const DebugStream& other)
+      : is_inline(other.is_inline),
+        indentation_space(other.indentation_space),
+        depth(other.depth),
+        nesting(other.nesting),
+        num_fields(other.num_fields),
+        is_json(other.is_json),
+        limits(other.limits),
+        buffer_(other.buffer_),
+        output_size_(other.output_size_),
+        truncated_(other.truncated_),
+        json_hook_(other.json_hook_) {}
+
+  // Takes over the sink, leaving `other` without one.
+  DebugStream(DebugStream&& other) noexcept
+      : is_inline(other.is_inline),
+        indentation_space(other.indentation_space),
+        depth(other.depth),
+        nesting(other.nesting),
+        num_fields(other.num_fields),
+        is_json(other.is_json),
+        limits(other.limits),
+        buffer_(std::move(other.buffer_)),
+        sink_(std::move(other.sink_)),
+        chunk_size_(other.chunk_size_),
+        output_size_(other.output_size_),
+        truncated_(other.truncated_),
+        json_hook_(other.json_hook_) {
+    other.buffer_.clear();
+    other.sink_ = nullptr;
+    other.chunk_size_ = std::numeric_limits<std::size_t>::max();
+  }
+
   template<typename... Ts>
   explicit DebugStream(const Ts&... input) {
     this->Consume(input...);
@@ -48,29 +186,66 @@ class DebugStream {
   inline DebugStream& Consume() {return *this;}
 
   inline DebugStream& TabSpace() {
-    oss << string(depth*indentation_space, ' ');
+    WriteSpaces(depth*indentation_space);
     return *this;
   }
 
+  // Appends raw bytes to the output, without interpreting newlines or
+  // branching characters.
+  inline DebugStream& Append(const char* data, std::size_t size) {
+    Write(data, size);
+    return *this;
+  }
+
+  inline DebugStream& Append(char c) {
+    Write(c);
+    return *this;
+  }
+
+  template<std::size_t N>
+  inline DebugStream& Append(const char (&literal)[N]) {
+    return Append(literal, N - 1);
+  }
+
   DebugStream& PrintChar(char c) {
-    oss << c;
+    Write(c);
     if (c == '\n') {
       TabSpace();
     }
     return *this;
   }
 
-  DebugStream& operator<<(uint8_t c) {
-    oss << static_cast<uint16_t>(c);
+  // Appends text, indenting after every newline. Runs without a newline are
+  // copied in a single append.
+  DebugStream& PrintText(const char* data, std::size_t size) {
+    const char* end = data + size;
+    while (data < end) {
+      const void* newline = std::memchr(data, '\n', end - data);
+      if (newline == nullptr) {
+        Write(data, end - data);
+        break;
+      }
+      const char* next = static_cast<const char*>(newline) + 1;
+      Write(data, next - data);
+      TabSpace();
+      data = next;
+    }
     return *this;
   }
 
+  DebugStream& operator<<(uint8_t c) {
+    return AppendInteger(static_cast<uint16_t>(c));
+  }
+
   DebugStream& operator<<(int8_t c) {
-    oss << static_cast<int16_t>(c);
-    return *this;
+    return AppendInteger(static_cast<int16_t>(c));
   }
 
   DebugStream& operator<<(char c) {
+    if (is_json) {
+      WriteJsonString(&c, 1);
+      return *this;
+    }
     switch (c) {
       case '{':
       case '[':
@@ -81,23 +256,40 @@ class DebugStream {
       case ')':
         return BranchEnd(c);
       case '\n':
-        oss << c;
+        Write(c);
         return TabSpace();
       default:
-        oss << c;
+        Write(c);
         break;
     }
     return *this;
   }
 
   template<typename T>
-  std::enable_if_t<(std::is_fundamental<T>::value), DebugStream>&
+  std::enable_if_t<(std::is_integral<T>::value), DebugStream>&
   operator<<(const T& input) {
-    oss << input;
-    return *this;
+    if (std::is_same<T, bool>::value && is_json) {
+      return (input ? Append("true") : Append("false"));
+    }
+    // Promotion mirrors std::ostream, which prints bool as 0/1 and wide
+    // character types as numbers.
+    return AppendInteger(+input);
+  }
+
+  template<typename T>
+  std::enable_if_t<(std::is_floating_point<T>::value), DebugStream>&
+  operator<<(const T& input) {
+    if (is_json && not std::isfinite(input)) {
+      return Append("null");
+    }
+    return AppendFloat(input);
   }
 
   DebugStream& operator<<(const char* input) {
+    if (is_json) {
+      WriteJsonString(input, std::strlen(input));
+      return *this;
+    }
     char c = input[0];
     if (c == 0) {
       return *this;
@@ -115,28 +307,179 @@ class DebugStream {
         default: break;
       }
     }
-    for (auto i = input; *i; i++) {
-      PrintChar(*i);
+    return PrintText(input, std::strlen(input));
+  }
+
+  // If a sink is set, returns only the output which is not flushed yet.
+  const std::string& str() const & {
+    return buffer_;
+  }
+
+  // Moves the rendered output out of a temporary stream, ex:
+  // `DebugStream(x).str()`.
+  std::string str() && {
+    return std::move(buffer_);
+  }
+
+  // Swaps the unflushed output with `other`, ex: for handing it over without
+  // a copy. Call Clear() before reusing the stream.
+  DebugStream& SwapBuffer(std::string& other) {  // NOLINT
+    buffer_.swap(other);
+    return *this;
+  }
+
+  // Clears the output and the branching state but keeps the settings and the
+  // allocated buffer, so that the stream can be reused for a new object.
+  DebugStream& Clear() {
+    buffer_.clear();
+    depth = 0;
+    nesting = 0;
+    num_fields = 0;
+    output_size_ = 0;
+    truncated_ = false;
+    json_hook_ = JsonHook();
+    return *this;
+  }
+
+  // Receives the rendered output in chunks, in order.
+  using Sink = std::function<void(const char* data, std::size_t size)>;
+
+  // Streams the output to `sink` whenever at least `chunk_size` bytes are
+  // buffered, so rendering a huge object needs only O(chunk_size) memory.
+  // Indentation state is kept by the stream, so chunk boundaries don't affect
+  // the output. Call Flush() (or destroy the stream) to emit the remainder.
+  DebugStream& SetSink(Sink sink, std::size_t chunk_size = 64 * 1024) {
+    Flush();
+    this->sink_ = std::move(sink);
+    this->chunk_size_ = (sink_ ? std::max<std::size_t>(chunk_size, 1)
+                               : std::numeric_limits<std::size_t>::max());
+    if (sink_) {
+      buffer_.reserve(std::min<std::size_t>(chunk_size_, 1 << 20));
+    }
+    return *this;
+  }
+
+  // Emits the buffered output to the sink, if any. Output which may still be
+  // taken back, by a hook rendered as a JSON string, is held until decided.
+  DebugStream& Flush() {
+    if (sink_ && not buffer_.empty() && not json_hook_.holds_output()) {
+      sink_(buffer_.data(), buffer_.size());
+      buffer_.clear();
     }
     return *this;
   }
 
-  std::string str() const {
-    return oss.str();
+  ~DebugStream() {
+    try {
+      Flush();
+    } catch (...) {}
   }
 
   DebugStream& operator<<(const std::string& input) {
-    for (auto c : input) {
-      PrintChar(c);
+    if (is_json) {
+      WriteJsonString(input.data(), input.size());
+      return *this;
+    }
+    return PrintText(input.data(), input.size());
+  }
+
+  // Describes a member from a `void DebugStream(quick::DebugStream&) const`
+  // hook. Renders "name = value" lines in text mode, and "\"name\": value"
+  // members in JSON mode. In JSON mode, a hook starting with a Field() must
+  // describe all its output with Field()s.
+  template<typename T>
+  DebugStream& Field(const char* name, const T& value) {
+    if (json_hook_.state == JsonHook::UNDECIDED) {
+      DecideJsonHook();
     }
+    if (not is_json) {
+      if (num_fields > 0) {
+        PrintChar('\n');
+      }
+      PrintText(name, std::strlen(name));
+      Append(" = ");
+      *this << value;
+    } else {
+      if (num_fields > 0) {
+        Write(',');
+        if (is_inline) {
+          Write(' ');
+        } else {
+          PrintChar('\n');
+        }
+      }
+      WriteJsonString(name, std::strlen(name));
+      Append(": ");
+      *this << value;
+    }
+    num_fields++;
+    return *this;
+  }
+
+  // Renders a type having `void DebugStream(quick::DebugStream&) const` member
+  // as a JSON object. Hooks describing their members with Field() produce a
+  // nested object, others are rendered as text in a JSON string.
+  //
+  // The hook writes into this stream directly, in inline text mode until its
+  // first Field() switches to JSON. The text is held in the buffer (not
+  // flushed), and is taken back at the end to be written as a JSON string.
+  template<typename T>
+  DebugStream& PrintJsonObject(const T& input) {
+    JsonHook enclosing_hook = json_hook_;
+    json_hook_.state = JsonHook::UNDECIDED;
+    json_hook_.buffer_start = buffer_.size();
+    json_hook_.output_start = output_size_;
+    json_hook_.truncated = truncated_;
+    json_hook_.is_inline = is_inline;
+    ScopedControlsStruct<uint32_t> num_fields_for_this_scope(0, &num_fields);
+    is_json = false;
+    is_inline = true;
+    input.DebugStream(*this);
+    is_json = true;
+    is_inline = json_hook_.is_inline;
+    if (json_hook_.state == JsonHook::FIELDS) {
+      BranchEnd('}');
+    } else if (buffer_.size() == json_hook_.buffer_start) {
+      BranchStart('{');
+      BranchEnd('}');
+    } else {
+      string text = buffer_.substr(json_hook_.buffer_start);
+      buffer_.resize(json_hook_.buffer_start);
+      output_size_ = json_hook_.output_start;
+      truncated_ = json_hook_.truncated;
+      // Same as the text rendering of the object, i.e. within braces.
+      Write('"');
+      Write('{');
+      WriteJsonStringContent(text.data(), text.size());
+      Write('}');
+      Write('"');
+    }
+    json_hook_ = enclosing_hook;
+    MaybeFlush();
+    return *this;
+  }
+
+  // Renders a map key. JSON keys must be strings, hence non-string keys are
+  // rendered inline and quoted.
+  template<typename T>
+  DebugStream& PrintKey(const T& key) {
+    SetInlineForThisScope is_inline_for_this_scope(true, &is_inline);
+    if (not is_json || std::is_convertible<const T&, std::string>::value) {
+      return *this << key;
+    }
+    DebugStream text;
+    text.is_json = true;
+    text.is_inline = true;
+    text << key;
+    WriteJsonString(text.buffer_.data(), text.buffer_.size());
     return *this;
   }
 
   template<typename T>
   inline DebugStream& BranchStartInternal(const T& input) {
-    oss << input;
+    AppendToken(input);
     if (not is_inline) {
-      oss << "\n";
+      Write('\n');
       depth++;
       TabSpace();
     }
@@ -146,14 +489,14 @@ class DebugStream {
   template<typename T>
   inline DebugStream& BranchEndInternal(const T& input) {
     if (not is_inline) {
-      oss << "\n";
+      Write('\n');
       if (depth == 0) {
         throw std::runtime_error("[quick::DebugStream]: Invalid BranchEnd");
       }
       depth--;
       TabSpace();
     }
-    oss << input;
+    AppendToken(input);
     return *this;
   }
 
@@ -193,6 +536,7 @@ class DebugStream {
 
   using SetInlineForThisScope = ScopedControlsStruct<bool>;
   using SetIndentationForThisScope = ScopedControlsStruct<uint8_t>;
+  using SetNestingForThisScope = ScopedControlsStruct<uint32_t>;
 
   // inline ScopedInlineStruct SetInlineForThisScope(bool value) {
   //   return ScopedInlineStruct(value, &this->is_inline);
@@ -211,18 +555,292 @@ class DebugStream {
     this->indentation_space = value;
     return *this;
   }
+
+  // In JSON mode, output is valid JSON: strings are quoted and escaped, map
+  // keys are strings, pairs are arrays and enums are numbers.
+  DebugStream& SetJson(bool value) {
+    this->is_json = value;
+    return *this;
+  }
+
+  DebugStream& SetLimits(const DebugLimits& value) {
+    this->limits = value;
+    return *this;
+  }
+
+  // True once the output is cut at limits.max_output_size. Further output is
+  // dropped, so loops over large containers may stop early.
+  bool truncated() const {
+    return truncated_;
+  }
+
   bool is_inline = false;
   uint8_t indentation_space = 2;
   uint32_t depth = 0;
+  // Number of enclosing containers, compared against limits.max_depth.
+  uint32_t nesting = 0;
+  // Number of Field()s written in the current object.
+  uint32_t num_fields = 0;
+  bool is_json = false;
+  DebugLimits limits;
+
+ private:
+  template<typename T>
+  DebugStream& AppendInteger(T value) {
+    char tmp[24];
+    char* end = tmp + sizeof(tmp);
+    char* begin = detail::FormatIntegerBackward(value, end);
+    Write(begin, end - begin);
+    return *this;
+  }
+
+  // Matches the default std::ostream formatting.
+  template<typename T>
+  DebugStream& AppendFloat(T value) {
+    char tmp[64];
+    Write(tmp, detail::FormatFloat(value, tmp));
+    return *this;
+  }
+
+  // Returns how many of the next `size` bytes fit in limits.max_output_size.
+  std::size_t Admit(std::size_t size) {
+    std::size_t available = 0;
+    if (limits.max_output_size > output_size_) {
+      available = limits.max_output_size - output_size_;
+    }
+    size = std::min(size, available);
+    output_size_ += size;
+    return size;
+  }
+
+  void WriteJsonString(const char* data, std::size_t size) {
+    Write('"');
+    WriteJsonStringContent(data, size);
+    Write('"');
+  }
+
+  // Escapes `data`, without the quotes.
+  void WriteJsonStringContent(const char* data, std::size_t size) {
+    const char* end = data + size;
+    while (data < end) {
+      std::size_t safe_size = detail::JsonSafePrefixSize(data, end - data);
+      Write(data, safe_size);
+      data += safe_size;
+      if (data == end) {
+        break;
+      }
+      WriteJsonEscaped(*data++);
+    }
+  }
+
+  void WriteJsonEscaped(char c) {
+    switch (c) {
+      case '"': return Write("\\\"", 2);
+      case '\\': return Write("\\\\", 2);
+      case '\n': return Write("\\n", 2);
+      case '\r': return Write("\\r", 2);
+      case '\t': return Write("\\t", 2);
+      case '\b': return Write("\\b", 2);
+      case '\f': return Write("\\f", 2);
+      default: {
+        const char* hex_digits = "0123456789abcdef";
+        char escaped[6] = {'\\', 'u', '0', '0',
+                           hex_digits[(c >> 4) & 0xF], hex_digits[c & 0xF]};
+        return Write(escaped, sizeof(escaped));
+      }
+    }
+  }
+
+  void Truncate() {
+    if (not truncated_) {
+      truncated_ = true;
+      WriteUnchecked(" ... (truncated)");
+    }
+  }
+
+  void Write(const char* data, std::size_t size) {
+    std::size_t admitted = Admit(size);
+    WriteUnchecked(data, admitted);
+    if (admitted < size) {
+      Truncate();
+    }
+  }
+
+  void Write(char c) {
+    if (Admit(1) == 0) {
+      return Truncate();
+    }
+    buffer_.push_back(c);
+    MaybeFlush();
+  }
+
+  // Indentation is copied from a static buffer of spaces, in chunks.
+  void WriteSpaces(std::size_t count) {
+    static constexpr char spaces[] =
+        "                                                                ";
+    constexpr std::size_t spaces_size = sizeof(spaces) - 1;
+    std::size_t admitted = Admit(count);
+    for (std::size_t remaining = admitted; remaining > 0;) {
+      std::size_t chunk = std::min(remaining, spaces_size);
+      WriteUnchecked(spaces, chunk);
+      remaining -= chunk;
+    }
+    if (admitted < count) {
+      Truncate();
+    }
+  }
+
+  template<std::size_t N>
+  void WriteUnchecked(const char (&literal)[N]) {
+    WriteUnchecked(literal, N - 1);
+  }
+
+  void WriteUnchecked(const char* data, std::size_t size) {
+    if (buffer_.size() + size >= chunk_size_ && not json_hook_.holds_output()) {
+      Flush();
+      if (size >= chunk_size_) {
+        // Large runs are handed to the sink as is, without buffering.
+        sink_(data, size);
+        return;
+      }
+    }
+    buffer_.append(data, size);
+  }
+
+  inline void MaybeFlush() {
+    if (buffer_.size() >= chunk_size_ && not json_hook_.holds_output()) {
+      Flush();
+    }
+  }
+
+  void AppendToken(char c) {
+    Write(c);
+  }
+
+  void AppendToken(const string& s) {
+    Write(s.data(), s.size());
+  }
+
+  std::string buffer_;
+  Sink sink_;
+  std::size_t chunk_size_ = std::numeric_limits<std::size_t>::max();
+  // Bytes emitted so far, including the flushed ones.
+  std::size_t output_size_ = 0;
+  bool truncated_ = false;
+  // State of the innermost hook rendered by PrintJsonObject().
+  struct JsonHook {
+    // UNDECIDED until the first Field(), or other output (TEXT).
+    enum State : uint8_t {NONE, UNDECIDED, FIELDS, TEXT};
+    State state = NONE;
+    // Where the output of the hook starts, for taking it back.
+    std::size_t buffer_start = 0;
+    std::size_t output_start = 0;
+    bool truncated = false;
+    // Layout of the enclosing JSON.
+    bool is_inline = false;
+
+    bool holds_output() const {
+      return state == UNDECIDED || state == TEXT;
+    }
+  };
+  JsonHook json_hook_;
+
+  // Called at the first Field() of a hook: the hook is rendered as a JSON
+  // object if it didn't write anything before.
+  void DecideJsonHook() {
+    if (buffer_.size() != json_hook_.buffer_start) {
+      json_hook_.state = JsonHook::TEXT;
+      return;
+    }
+    json_hook_.state = JsonHook::FIELDS;
+    is_json = true;
+    is_inline = json_hook_.is_inline;
+    BranchStart('{');
+  }
 };
 
+// Sink for DebugStream::SetSink, writing to `os`. `os` must outlive the
+// DebugStream.
+inline DebugStream::Sink OstreamSink(std::ostream& os) {
+  return [&os](const char* data, std::size_t size) {
+    os.write(data, size);
+  };
+}
+
+// Sink for DebugStream::SetSink, writing to the file descriptor `fd` with
+// write(2). Doesn't take the ownership of `fd`.
+inline DebugStream::Sink FileDescriptorSink(int fd) {
+  return [fd](const char* data, std::size_t size) {
+    while (size > 0) {
+      ssize_t written = ::write(fd, data, size);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::runtime_error("[quick::DebugStream]: Failed to write to fd");
+      }
+      data += written;
+      size -= written;
+    }
+  };
+}
+
 namespace detail {
+
+// Prints the elements skipped due to limits.max_container_size, ex:
+// "... (7 more)".
+inline void PrintElision(DebugStream& ds,  // NOLINT
+                         std::size_t printed,
+                         std::size_t total) {
+  ds << ("... (" + std::to_string(total - printed) + " more)");
+}
+
+template<typename T>
+struct IsStdArray: std::false_type {};
+
+template<typename T, std::size_t N>
+struct IsStdArray<std::array<T, N>>: std::true_type {};
+
+// Prints the elements of a pair or tuple, as "(a, b, c)" (array in JSON).
+template<typename Tuple, std::size_t... index>
+DebugStream& PrintTuple(DebugStream& ds,  // NOLINT
+                        const Tuple& input,
+                        std::index_sequence<index...>) {
+  if (sizeof...(index) == 0) {
+    return ds.Append(ds.is_json ? "[]" : "()");
+  }
+  if (ds.nesting >= ds.limits.max_depth) {
+    return ds << "(...)";
+  }
+  DebugStream::SetNestingForThisScope nesting(ds.nesting + 1, &ds.nesting);
+  ds.BranchStart(ds.is_json ? '[' : '(');
+  using expander = int[];
+  (void) expander {0, ((void) ((index == 0 ? ds : ds.Append(", "))
+                               << std::get<index>(input)), 0)...};
+  ds.BranchEnd(ds.is_json ? ']' : ')');
+  return ds;
+}
+
+template<typename... Ts, std::size_t... index>
+DebugStream& PrintQuickVariant(DebugStream& ds,  // NOLINT
+                               const quick::variant<Ts...>& input,
+                               std::index_sequence<index...>) {
+  using expander = int[];
+  (void) expander {0, ((input.selected_type() == index ?
+                          (void) (ds << input.template at<index>()) :
+                          (void) 0), 0)...};
+  return ds;
 }
 
+}  // namespace detail
+
 
 template<typename T>
 std::enable_if_t<std::is_enum<T>::value, DebugStream>&
 operator<<(DebugStream& ds, const T& input) {
+  if (ds.is_json) {
+    return ds << static_cast<int32_t>(input);
+  }
   ds << "ENUM-" << static_cast<int32_t>(input);
   return ds;
 }
@@ -231,20 +849,36 @@ operator<<(DebugStream& ds, const T& input) {
 template<typename T>
 std::enable_if_t<(quick::is_specialization<T, std::vector>::value ||
                   quick::is_specialization<T, std::list>::value ||
+                  quick::is_specialization<T, std::deque>::value ||
                   quick::is_specialization<T, std::unordered_set>::value ||
-                  quick::is_specialization<T, std::set>::value), DebugStream>&
+                  quick::is_specialization<T, std::set>::value ||
+                  detail::IsStdArray<T>::value), DebugStream>&
 operator<<(DebugStream& ds, const T& input) {
   if (input.size() == 0) {
-    ds << "[]";
+    ds.Append("[]");
+  } else if (ds.nesting >= ds.limits.max_depth) {
+    ds << "[...]";
   } else {
-    ds << '[';
-    bool is_first_item = true;
+    DebugStream::SetNestingForThisScope nesting(ds.nesting + 1, &ds.nesting);
+    ds.BranchStart('[');
+    std::size_t num_printed = 0;
     for (const auto& item : input) {
-      ds.oss << (is_first_item ? "" : ", ");
+      if (num_printed == ds.limits.max_container_size || ds.truncated()) {
+        break;
+      }
+      if (num_printed > 0) {
+        ds.Append(", ");
+      }
       ds << item;
-      is_first_item = false;
+      num_printed++;
     }
-    ds << ']';
+    if (num_printed < input.size() && not ds.truncated()) {
+      if (num_printed > 0) {
+        ds.Append(", ");
+      }
+      detail::PrintElision(ds, num_printed, input.size());
+    }
+    ds.BranchEnd(']');
   }
   return ds;
 }
@@ -255,37 +889,79 @@ std::enable_if_t<(quick::is_specialization<T, std::map>::value ||
                  DebugStream>&
 operator<<(DebugStream& ds, const T& input) {
   if (input.size() == 0) {
-    ds << "{}";
+    ds.Append("{}");
+  } else if (ds.nesting >= ds.limits.max_depth) {
+    ds << "{...}";
   } else {
-    ds << '{';
-    bool is_first_item = true;
+    DebugStream::SetNestingForThisScope nesting(ds.nesting + 1, &ds.nesting);
+    ds.BranchStart('{');
+    std::size_t num_printed = 0;
+    auto print_separator = [&ds]() {
+      ds.Append(',');
+      if (not ds.is_inline) {
+        ds.PrintChar('\n');
+      }
+    };
     for (const auto& item : input) {
-      if (not is_first_item) {
-        ds.oss << ",";
-        if (not ds.is_inline) {
-          ds << "\n";
-        }
+      if (num_printed == ds.limits.max_container_size || ds.truncated()) {
+        break;
       }
-      {
-        auto is_inline_prv_value = ds.is_inline;
-        ds.is_inline = true;
-        ds << item.first;
-        ds.is_inline = is_inline_prv_value;
+      if (num_printed > 0) {
+        print_separator();
       }
-      ds.oss << ": ";
+      ds.PrintKey(item.first);
+      ds.Append(": ");
       ds << item.second;
-      is_first_item = false;
+      num_printed++;
+    }
+    if (num_printed < input.size() && not ds.truncated()) {
+      if (num_printed > 0) {
+        print_separator();
+      }
+      detail::PrintElision(ds, num_printed, input.size());
     }
-    ds << '}';
+    ds.BranchEnd('}');
   }
   return ds;
 }
 
 template<typename T1, typename T2>
 DebugStream& operator<<(DebugStream& ds, const std::pair<T1, T2>& input) {
-  ds << "(" << input.first << ", " << input.second << ")";
+  return detail::PrintTuple(ds, input, std::make_index_sequence<2>());
+}
+
+template<typename... Ts>
+DebugStream& operator<<(DebugStream& ds, const std::tuple<Ts...>& input) {
+  return detail::PrintTuple(ds, input, std::index_sequence_for<Ts...>());
+}
+
+// Prints the selected alternative, or null if it's not initialized.
+template<typename... Ts>
+DebugStream& operator<<(DebugStream& ds, const quick::variant<Ts...>& input) {
+  if (not input.initialized()) {
+    return ds.Append("null");
+  }
+  return detail::PrintQuickVariant(ds, input, std::index_sequence_for<Ts...>());
+}
+
+#if __cplusplus >= 201703L
+template<typename T>
+DebugStream& operator<<(DebugStream& ds, const std::optional<T>& input) {
+  if (not input.has_value()) {
+    return ds.Append("null");
+  }
+  return ds << *input;
+}
+
+template<typename... Ts>
+DebugStream& operator<<(DebugStream& ds, const std::variant<Ts...>& input) {
+  if (input.valueless_by_exception()) {
+    return ds.Append("null");
+  }
+  std::visit([&ds](const auto& value) { ds << value; }, input);
   return ds;
 }
+#endif
 
 template<typename T>
 std::enable_if_t<
@@ -295,9 +971,18 @@ std::enable_if_t<
                    std::declval<quick::DebugStream&>()))>::value,
   DebugStream>&
 operator<<(DebugStream& ds, const T& input) {
-  ds << "{";
+  if (ds.nesting >= ds.limits.max_depth) {
+    ds << "{...}";
+    return ds;
+  }
+  DebugStream::SetNestingForThisScope nesting(ds.nesting + 1, &ds.nesting);
+  if (ds.is_json) {
+    return ds.PrintJsonObject(input);
+  }
+  DebugStream::ScopedControlsStruct<uint32_t> num_fields(0, &ds.num_fields);
+  ds.BranchStart('{');
   input.DebugStream(ds);
-  ds << "}";
+  ds.BranchEnd('}');
   return ds;
 }
 
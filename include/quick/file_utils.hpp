@@ -4,18 +4,27 @@
 #ifndef QUICK_FILE_UTILS_HPP_
 #define QUICK_FILE_UTILS_HPP_
 
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
 #include <utility>
 #include <string>
 #include <sstream>
 #include <ostream>  // NOLINT
 #include <fstream>  // NOLINT
 
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
 namespace quick {
 
 // Possible use: `throw FileException(FileException::FAILED_TO_OPEN, file_name)`
 //                in case of exception during file reading.
 struct FileException : public std::exception {
-  enum ErrorType {UNKNOWN, FAILED_TO_OPEN, FAILED_TO_WRITE};
+  enum ErrorType {UNKNOWN, FAILED_TO_OPEN, FAILED_TO_WRITE, FAILED_TO_READ};
   FileException();
   explicit FileException(ErrorType type);
   FileException(ErrorType type, const std::string& file_name);
@@ -30,12 +39,213 @@ struct FileException : public std::exception {
   void BuildErrorMessage();
 };
 
+// Throws FileException if the file can't be opened or read.
 std::string ReadFile(const std::string& file_name);
 
+// Truncates and writes the file in place. A crash or a concurrent reader may
+// see a partially written file, see WriteFileAtomically otherwise.
 void WriteFile(const std::string& file_name, const std::string& content);
 
+// Durability levels of WriteFileAtomically, from the fastest to the safest.
+enum class FileDurability {
+  // Atomic replacement only. After a crash, the file may have the old
+  // content, or (depending on the file system) be empty.
+  NONE,
+  // The content is flushed to the disk (fdatasync) before the rename, so
+  // after a crash the file has either the old or the new content.
+  DATA,
+  // Additionally syncs the directory after the rename, so the new content
+  // survives a crash once the call returns.
+  FULL
+};
+
+// Writes `content` into a temporary file in the same directory, and renames
+// it over `file_name`, so readers see either the old or the new content,
+// never a partial one. The permissions of an existing file are kept.
+// Throws FileException (FAILED_TO_WRITE) on failure, leaving the old file
+// untouched, unless only the final directory sync failed.
+void WriteFileAtomically(const std::string& file_name,
+                         const std::string& content,
+                         FileDurability durability = FileDurability::FULL);
+
 bool DoesFileExist(const std::string& file_name);
 
+struct MappedFileOptions {
+  // Passed to madvise(2).
+  enum AccessPattern {NORMAL, SEQUENTIAL, RANDOM};
+  AccessPattern access_pattern = NORMAL;
+  // Prefaults all the pages (MAP_POPULATE), avoiding page faults later.
+  bool populate = false;
+  // Hints the kernel to back the mapping with transparent huge pages, where
+  // supported (MADV_HUGEPAGE). Ignored otherwise.
+  bool huge_pages = false;
+};
+
+// Read only memory mapping of a file, for loading large files without
+// copying them into the heap. Pages are loaded by the kernel on first access,
+// or upfront with `populate`.
+//
+// Sample usage:
+// qk::MappedFile file(file_name, {qk::MappedFileOptions::SEQUENTIAL});
+// qk::ByteStream bs;
+// bs.SetView(file.data(), file.size());
+// bs >> object;
+class MappedFile {
+ public:
+  MappedFile() = default;
+  // Throws FileException if the file can't be opened or mapped.
+  explicit MappedFile(const std::string& file_name,
+                      const MappedFileOptions& options = MappedFileOptions());
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  const char* data() const {
+    return data_;
+  }
+  std::size_t size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+#if __cplusplus >= 201703L
+  std::string_view view() const {
+    return std::string_view(data_, size_);
+  }
+#endif
+
+ private:
+  void Unmap();
+
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+struct LineReaderOptions {
+  // Size of the chunks read from the file. Lines longer than a chunk are
+  // assembled in a separate buffer.
+  std::size_t buffer_size = 1 << 20;
+  // Reads the next chunk on a background thread while the current one is
+  // being processed, using a second buffer. Regular files only, ignored for
+  // pipes, FIFOs and devices, whose reads may block indefinitely.
+  bool readahead = false;
+};
+
+// Reads a file line by line in large chunks, with bounded memory, for text
+// files too large for ReadFile. Lines are returned without their '\n' and
+// point into the chunk (no copy), staying valid until the next call to
+// Next(). The last line may lack the '\n'.
+//
+// Sample usage:
+// qk::LineReader reader(file_name);
+// std::string_view line;
+// while (reader.Next(line)) {
+//   ....
+// }
+class LineReader {
+ public:
+  class Readahead;
+
+  // Throws FileException (FAILED_TO_OPEN) if the file can't be opened.
+  explicit LineReader(const std::string& file_name,
+                      const LineReaderOptions& options = LineReaderOptions());
+  LineReader(const LineReader&) = delete;
+  LineReader& operator=(const LineReader&) = delete;
+  ~LineReader();
+
+  // Returns false at the end of the file. Throws FileException
+  // (FAILED_TO_READ) on read errors.
+  bool Next(const char*& data, std::size_t& size);  // NOLINT
+  // Copies the line into `line`.
+  bool Next(std::string& line);  // NOLINT
+#if __cplusplus >= 201703L
+  bool Next(std::string_view& line) {  // NOLINT
+    const char* data;
+    std::size_t size;
+    if (not Next(data, size)) {
+      return false;
+    }
+    line = std::string_view(data, size);
+    return true;
+  }
+#endif
+
+ private:
+  // Moves to the next chunk. Returns false at the end of the file.
+  bool NextChunk();
+
+  std::string file_name_;
+  int fd_;
+  std::size_t buffer_size_;
+  std::unique_ptr<char[]> buffer_;
+  std::unique_ptr<Readahead> readahead_;
+  const char* pos_ = nullptr;
+  const char* end_ = nullptr;
+  bool eof_ = false;
+  // Holds the lines spanning several chunks.
+  std::string carry_;
+};
+
+struct AsyncFileIOOptions {
+  enum Backend {AUTO, IO_URING, THREAD_POOL};
+  // AUTO picks IO_URING when the kernel supports it.
+  Backend backend = AUTO;
+  // Maximum number of operations in flight in io_uring. Further requests are
+  // queued.
+  std::size_t queue_depth = 256;
+  // Number of worker threads of the THREAD_POOL backend.
+  std::size_t num_threads = 8;
+};
+
+// Reads and writes whole files asynchronously, so that a single thread can
+// keep hundreds of operations in flight. Backed by io_uring where available,
+// and by a pool of threads doing blocking ReadFile / WriteFile otherwise.
+// Files are opened by the calling thread, the data transfer is asynchronous.
+// Callbacks are called from a background thread (or right away, from the
+// calling thread, if the file fails to open), and may issue new requests.
+// If waiting for io_uring completions fails, all the requests fail.
+// The destructor waits for all the requests to complete.
+//
+// Sample usage:
+// qk::AsyncFileIO io;
+// std::vector<std::future<std::string>> contents;
+// for (auto& file_name : file_names) {
+//   contents.push_back(io.Read(file_name));
+// }
+// ....
+// std::string content = contents[i].get();  // Throws FileException on error.
+class AsyncFileIO {
+ public:
+  using ReadCallback = std::function<void(std::string content,
+                                          std::exception_ptr error)>;
+  using WriteCallback = std::function<void(std::exception_ptr error)>;
+  class Executor;
+
+  explicit AsyncFileIO(const AsyncFileIOOptions& options =
+                           AsyncFileIOOptions());
+  AsyncFileIO(const AsyncFileIO&) = delete;
+  AsyncFileIO& operator=(const AsyncFileIO&) = delete;
+  ~AsyncFileIO();
+
+  // `error` is set (to a FileException) on failure. Thread safe.
+  void Read(const std::string& file_name, ReadCallback callback);
+  std::future<std::string> Read(const std::string& file_name);
+
+  // Truncates and writes the file in place, like WriteFile. Thread safe.
+  void Write(const std::string& file_name, std::string content,
+             WriteCallback callback);
+  std::future<void> Write(const std::string& file_name, std::string content);
+
+  // Either IO_URING or THREAD_POOL.
+  AsyncFileIOOptions::Backend backend() const;
+
+ private:
+  std::unique_ptr<Executor> executor_;
+};
+
 }  // namespace quick
 
 namespace qk = quick;
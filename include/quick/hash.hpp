@@ -29,6 +29,12 @@
 #include <tuple>
 #include <list>
 
+#include "quick/variant.hpp"
+
+#if __cplusplus >= 201703L
+#include <variant>
+#endif
+
 namespace quick {
 namespace detail_hash_impl {
 template<typename...> using void_t = void;
@@ -159,6 +165,37 @@ struct hash_impl<std::tuple<Ts...>> {
   }
 };
 
+// Combines the selected type with the hash of the selected alternative.
+template<typename... Ts>
+struct hash_impl<quick::variant<Ts...>> {
+  std::size_t operator()(const quick::variant<Ts...>& t) const {
+    std::size_t value_hash = 0;
+    if (t.initialized()) {
+      value_hash = quick::visit([](const auto& value) {
+        return hash_impl<std::decay_t<decltype(value)>>()(value);
+      }, t);
+    }
+    std::vector<std::size_t> v = {t.selected_type(), value_hash};
+    return OrderedSequenceHash(v);
+  }
+};
+
+#if __cplusplus >= 201703L
+template<typename... Ts>
+struct hash_impl<std::variant<Ts...>> {
+  std::size_t operator()(const std::variant<Ts...>& t) const {
+    std::size_t value_hash = 0;
+    if (not t.valueless_by_exception()) {
+      value_hash = std::visit([](const auto& value) {
+        return hash_impl<std::decay_t<decltype(value)>>()(value);
+      }, t);
+    }
+    std::vector<std::size_t> v = {t.index(), value_hash};
+    return OrderedSequenceHash(v);
+  }
+};
+#endif
+
 template<typename T>
 struct hash_impl<T, std::enable_if_t<std::is_enum<T>::value>> {
   std::size_t operator()(const T& t) const {
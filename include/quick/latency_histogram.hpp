@@ -0,0 +1,251 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#ifndef QUICK_LATENCY_HISTOGRAM_HPP_
+#define QUICK_LATENCY_HISTOGRAM_HPP_
+
+// Histogram of latencies (or any non negative integer samples) with bounded
+// relative error, in the spirit of HdrHistogram. Recording is O(1) and the
+// memory is fixed, regardless of the number of samples.
+//
+// Sample usage:
+// qk::LatencyHistogram histogram;
+// qk::MicroSecondTimer timer;
+// ....
+// histogram.Record(timer.GetElapsedTime());
+// ....
+// int64_t p99 = histogram.Percentile(99);
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "quick/byte_stream.hpp"
+#include "quick/debug_stream.hpp"
+
+namespace quick {
+namespace detail {
+
+// Log-linear buckets: values below 2^sub_bucket_bits get a bucket each, and
+// every power of 2 range above is split into 2^sub_bucket_bits equal buckets,
+// so a bucket is never wider than 1/2^sub_bucket_bits of its values.
+inline std::size_t LogLinearBucketIndex(uint64_t value, int sub_bucket_bits) {
+  if (value < (uint64_t(1) << sub_bucket_bits)) {
+    return static_cast<std::size_t>(value);
+  }
+  int shift = 63 - __builtin_clzll(value) - sub_bucket_bits;
+  uint64_t sub_bucket = (value >> shift) &
+                        ((uint64_t(1) << sub_bucket_bits) - 1);
+  return (static_cast<std::size_t>(shift + 1) << sub_bucket_bits) +
+         sub_bucket;
+}
+
+inline uint64_t LogLinearBucketLowerBound(std::size_t index,
+                                          int sub_bucket_bits) {
+  if (index < (std::size_t(1) << sub_bucket_bits)) {
+    return index;
+  }
+  int shift = static_cast<int>(index >> sub_bucket_bits) - 1;
+  uint64_t sub_bucket = index & ((std::size_t(1) << sub_bucket_bits) - 1);
+  return ((uint64_t(1) << sub_bucket_bits) + sub_bucket) << shift;
+}
+
+inline uint64_t LogLinearBucketWidth(std::size_t index, int sub_bucket_bits) {
+  if (index < (std::size_t(1) << sub_bucket_bits)) {
+    return 1;
+  }
+  return uint64_t(1) << ((index >> sub_bucket_bits) - 1);
+}
+
+}  // namespace detail
+
+// Not Thread Safe
+//
+// Values are tracked from 0 to `highest_value` with `significant_digits`
+// (1 to 5) decimal digits of precision, i.e. a percentile is within a
+// relative error of 10^-significant_digits of the exact one. Values out of
+// range are clamped. Histograms recorded by different threads (or
+// processes, see Serialize()) can be combined with Merge(), if they have the
+// same configuration.
+class LatencyHistogram {
+ public:
+  // Defaults to one hour in micro seconds, using ~26KB.
+  explicit LatencyHistogram(int64_t highest_value = 3600LL * 1000 * 1000,
+                            int significant_digits = 2) {
+    Init(highest_value, significant_digits);
+  }
+
+  void Record(int64_t value, uint64_t count = 1) {
+    value = std::min(std::max<int64_t>(value, 0), highest_value_);
+    buckets_[detail::LogLinearBucketIndex(value, sub_bucket_bits_)] += count;
+    count_ += count;
+    total_ += static_cast<uint64_t>(value) * count;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  void Merge(const LatencyHistogram& other) {
+    if (other.highest_value_ != highest_value_ ||
+        other.significant_digits_ != significant_digits_) {
+      throw std::runtime_error(
+          "[quick::LatencyHistogram]: Merging histograms of different "
+          "configurations.");
+    }
+    for (std::size_t i = 0; i < buckets_.size(); i++) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    total_ += other.total_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  void Clear() {
+    std::fill(buckets_.begin(), buckets_.end(), 0);
+    count_ = 0;
+    total_ = 0;
+    min_ = std::numeric_limits<int64_t>::max();
+    max_ = 0;
+  }
+
+  uint64_t Count() const {
+    return count_;
+  }
+  // Min(), Max() and Mean() are exact, and 0 for an empty histogram.
+  int64_t Min() const {
+    return count_ == 0 ? 0 : min_;
+  }
+  int64_t Max() const {
+    return max_;
+  }
+  double Mean() const {
+    return count_ == 0 ? 0 : static_cast<double>(total_) / count_;
+  }
+
+  // Value under which `percentile` (in [0, 100]) percent of the samples
+  // fall, i.e. the highest value equivalent to the sample of that rank.
+  int64_t Percentile(double percentile) const {
+    if (count_ == 0) {
+      return 0;
+    }
+    double rank = std::ceil(percentile / 100.0 * count_);
+    uint64_t target = std::min(std::max<uint64_t>(rank, 1), count_);
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets_.size(); i++) {
+      seen += buckets_[i];
+      if (seen >= target) {
+        uint64_t highest = detail::LogLinearBucketLowerBound(
+                               i, sub_bucket_bits_) +
+                           detail::LogLinearBucketWidth(
+                               i, sub_bucket_bits_) - 1;
+        return std::min(std::max(static_cast<int64_t>(highest), min_), max_);
+      }
+    }
+    return max_;
+  }
+
+  int64_t HighestValue() const {
+    return highest_value_;
+  }
+  int SignificantDigits() const {
+    return significant_digits_;
+  }
+  // Memory used by the buckets.
+  std::size_t NumBuckets() const {
+    return buckets_.size();
+  }
+
+  void DebugStream(quick::DebugStream& ds) const {  // NOLINT
+    ds.Field("count", count_)
+      .Field("min", Min())
+      .Field("mean", Mean())
+      .Field("p50", Percentile(50))
+      .Field("p90", Percentile(90))
+      .Field("p99", Percentile(99))
+      .Field("p999", Percentile(99.9))
+      .Field("max", Max());
+  }
+
+  // Only the non empty buckets are written.
+  void Serialize(quick::OByteStream& bs) const {  // NOLINT
+    std::vector<std::pair<uint32_t, uint64_t>> buckets;
+    for (std::size_t i = 0; i < buckets_.size(); i++) {
+      if (buckets_[i] != 0) {
+        buckets.emplace_back(static_cast<uint32_t>(i), buckets_[i]);
+      }
+    }
+    bs << highest_value_ << static_cast<int32_t>(significant_digits_)
+       << count_ << total_ << min_ << max_ << buckets;
+  }
+
+  void Deserialize(quick::IByteStream& bs) {  // NOLINT
+    int64_t highest_value;
+    int32_t significant_digits;
+    bs >> highest_value >> significant_digits;
+    Init(highest_value, significant_digits);
+    std::vector<std::pair<uint32_t, uint64_t>> buckets;
+    bs >> count_ >> total_ >> min_ >> max_ >> buckets;
+    for (auto& bucket : buckets) {
+      if (bucket.first >= buckets_.size()) {
+        throw std::runtime_error(
+            "[quick::LatencyHistogram]: Invalid bucket index.");
+      }
+      buckets_[bucket.first] = bucket.second;
+    }
+  }
+
+  bool operator==(const LatencyHistogram& other) const {
+    return highest_value_ == other.highest_value_ &&
+           significant_digits_ == other.significant_digits_ &&
+           count_ == other.count_ && total_ == other.total_ &&
+           Min() == other.Min() && max_ == other.max_ &&
+           buckets_ == other.buckets_;
+  }
+  bool operator!=(const LatencyHistogram& other) const {
+    return not (*this == other);
+  }
+
+ private:
+  void Init(int64_t highest_value, int significant_digits) {
+    if (significant_digits < 1 || significant_digits > 5) {
+      throw std::runtime_error(
+          "[quick::LatencyHistogram]: significant_digits must be in [1, 5].");
+    }
+    if (highest_value < 1) {
+      throw std::runtime_error(
+          "[quick::LatencyHistogram]: highest_value must be positive.");
+    }
+    highest_value_ = highest_value;
+    significant_digits_ = significant_digits;
+    uint64_t precision = 1;
+    for (int i = 0; i < significant_digits; i++) {
+      precision *= 10;
+    }
+    sub_bucket_bits_ = 0;
+    while ((uint64_t(1) << sub_bucket_bits_) < precision) {
+      sub_bucket_bits_++;
+    }
+    buckets_.assign(detail::LogLinearBucketIndex(highest_value,
+                                                 sub_bucket_bits_) + 1, 0);
+    Clear();
+  }
+
+  int64_t highest_value_;
+  int significant_digits_;
+  int sub_bucket_bits_;
+  std::vector<uint64_t> buckets_;
+  uint64_t count_;
+  uint64_t total_;
+  int64_t min_;
+  int64_t max_;
+};
+
+}  // namespace quick
+
+namespace qk = quick;
+
+#endif  // QUICK_LATENCY_HISTOGRAM_HPP_
@@ -0,0 +1,116 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#ifndef QUICK_MPSC_RING_BUFFER_HPP_
+#define QUICK_MPSC_RING_BUFFER_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace quick {
+
+// Bounded, lock-free, multi-producer single-consumer queue.
+// Each cell carries a sequence number telling whether it's free for the
+// producer at position `pos` (sequence == pos) or holds the element for the
+// consumer (sequence == pos + 1), hence producers only contend on a single
+// fetch of the enqueue position.
+//
+// Elements are exchanged with std::swap, so the cells keep the resources
+// (ex: string capacity) of the elements swapped out, which get recycled to the
+// producers.
+//
+// Sample usage:
+// qk::MpscRingBuffer<std::string> queue(1024);
+// std::string s = "record";
+// queue.TryPush(s);  // From any thread.
+// queue.TryPop(s);   // From the consumer thread only.
+template<typename T>
+class MpscRingBuffer {
+ public:
+  // `capacity` must be a power of 2.
+  explicit MpscRingBuffer(std::size_t capacity)
+      : cells_(new Cell[capacity]()), mask_(capacity - 1) {
+    if (capacity < 2 || (capacity & mask_) != 0) {
+      throw std::invalid_argument("[quick::MpscRingBuffer]: capacity must be "
+                                  "a power of 2");
+    }
+    for (std::size_t i = 0; i < capacity; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  MpscRingBuffer(const MpscRingBuffer&) = delete;
+  MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+
+  // Swaps `value` into the queue. Returns false, leaving `value` untouched, if
+  // the queue is full. Thread safe.
+  bool TryPush(T& value) {  // NOLINT
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    std::swap(cell->value, value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Swaps the oldest element out of the queue into `value`. Returns false if
+  // the queue is empty. Must be called from a single consumer thread.
+  bool TryPop(T& value) {  // NOLINT
+    Cell* cell = &cells_[dequeue_pos_ & mask_];
+    std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    if (sequence != dequeue_pos_ + 1) {
+      return false;
+    }
+    std::swap(cell->value, value);
+    cell->sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    dequeue_pos_++;
+    return true;
+  }
+
+  std::size_t capacity() const {
+    return mask_ + 1;
+  }
+
+  // Number of positions claimed by TryPush so far, including the elements
+  // still being swapped in. The consumer pops them in this order.
+  std::size_t num_claimed() const {
+    return enqueue_pos_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr std::size_t kCacheLineSize = 64;
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+  std::unique_ptr<Cell[]> cells_;
+  const std::size_t mask_;
+  // Padding keeps the producers' and the consumer's positions on different
+  // cache lines.
+  char padding1_[kCacheLineSize];
+  std::atomic<std::size_t> enqueue_pos_ {0};
+  char padding2_[kCacheLineSize];
+  std::size_t dequeue_pos_ = 0;
+};
+
+}  // namespace quick
+
+namespace qk = quick;
+
+#endif  // QUICK_MPSC_RING_BUFFER_HPP_
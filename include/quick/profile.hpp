@@ -0,0 +1,353 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#ifndef QUICK_PROFILE_HPP_
+#define QUICK_PROFILE_HPP_
+
+// Scoped profiling zones for hot paths. A zone costs two CycleTimer reads and
+// a few relaxed stores into counters owned by the calling thread, hence no
+// locks and no shared cache lines on the hot path. The per-thread counters
+// are merged on demand (ex: periodically, with quick::ProfileReporter) into
+// a quick::ProfileReport, rendered with quick::DebugStream.
+//
+// Sample usage:
+// void ParseRequest(...) {
+//   QUICK_PROFILE_SCOPE("ParseRequest");
+//   ....
+// }
+// ....
+// std::cout << qk::DebugStream(qk::GetProfileReport()).str() << std::endl;
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <stdexcept>
+#include <string>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "quick/debug_stream.hpp"
+#include "quick/latency_histogram.hpp"
+#include "quick/time.hpp"
+
+namespace quick {
+namespace profile_impl {
+
+constexpr std::size_t kMaxZones = 1024;
+
+// Bucketing of quick::LatencyHistogram, bounding the relative error of a
+// percentile to 1/2^kSubBucketBits.
+constexpr int kSubBucketBits = 3;
+constexpr std::size_t kNumBuckets = (64 - kSubBucketBits + 1)
+                                    << kSubBucketBits;
+
+inline std::size_t BucketIndex(uint64_t value) {
+  return detail::LogLinearBucketIndex(value, kSubBucketBits);
+}
+
+// Middle of the range of values falling into the bucket `index`.
+inline uint64_t BucketValue(std::size_t index) {
+  return detail::LogLinearBucketLowerBound(index, kSubBucketBits) +
+         detail::LogLinearBucketWidth(index, kSubBucketBits) / 2;
+}
+
+// Counters of a zone, written by a single thread and read by the merger, so
+// the updates are plain relaxed load + store instead of read-modify-writes.
+struct ZoneCounters {
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> total{0};
+  std::atomic<uint64_t> min{std::numeric_limits<uint64_t>::max()};
+  std::atomic<uint64_t> max{0};
+  std::atomic<uint64_t> buckets[kNumBuckets] = {};
+
+  static void Add(std::atomic<uint64_t>& counter, uint64_t value) {  // NOLINT
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+
+  void Record(uint64_t ticks) {
+    Add(count, 1);
+    Add(total, ticks);
+    if (ticks < min.load(std::memory_order_relaxed)) {
+      min.store(ticks, std::memory_order_relaxed);
+    }
+    if (ticks > max.load(std::memory_order_relaxed)) {
+      max.store(ticks, std::memory_order_relaxed);
+    }
+    Add(buckets[BucketIndex(ticks)], 1);
+  }
+};
+
+// Counters of a thread, indexed by the zone id. Allocated on the first use of
+// a zone by the thread, and kept after the thread exits.
+struct ThreadCounters {
+  std::atomic<ZoneCounters*> zones[kMaxZones] = {};
+
+  ~ThreadCounters() {
+    for (auto& zone : zones) {
+      delete zone.load(std::memory_order_relaxed);
+    }
+  }
+};
+
+class Registry;
+
+}  // namespace profile_impl
+
+// Merged statistics of a zone, in nano seconds.
+struct ProfileZoneStats {
+  std::string name;
+  uint64_t count = 0;
+  int64_t total_ns = 0;
+  int64_t min_ns = 0;
+  int64_t max_ns = 0;
+  // Number of samples per profile_impl bucket, in CycleTimer ticks.
+  std::vector<uint64_t> buckets;
+
+  int64_t MeanNanoSeconds() const {
+    return count == 0 ? 0 : total_ns / static_cast<int64_t>(count);
+  }
+
+  // Approximate duration under which `percentile` (in [0, 100]) percent of
+  // the samples fall.
+  int64_t PercentileNanoSeconds(double percentile) const {
+    if (count == 0) {
+      return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * count + 0.5);
+    rank = std::min(std::max<uint64_t>(rank, 1), count);
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); i++) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        int64_t value = CycleTimer::ToNanoSeconds(
+                            profile_impl::BucketValue(i));
+        return std::min(std::max(value, min_ns), max_ns);
+      }
+    }
+    return max_ns;
+  }
+
+  void DebugStream(quick::DebugStream& ds) const {  // NOLINT
+    ds.Field("name", name)
+      .Field("count", count)
+      .Field("total_ns", total_ns)
+      .Field("mean_ns", MeanNanoSeconds())
+      .Field("min_ns", min_ns)
+      .Field("p50_ns", PercentileNanoSeconds(50))
+      .Field("p90_ns", PercentileNanoSeconds(90))
+      .Field("p99_ns", PercentileNanoSeconds(99))
+      .Field("max_ns", max_ns);
+  }
+};
+
+// Zones sorted by the total time spent, descending.
+struct ProfileReport {
+  std::vector<ProfileZoneStats> zones;
+
+  void DebugStream(quick::DebugStream& ds) const {  // NOLINT
+    ds.Field("zones", zones);
+  }
+};
+
+namespace profile_impl {
+
+// Process wide list of zones and threads. Leaked on purpose, so that the
+// threads still running at exit can keep recording.
+class Registry {
+ public:
+  static Registry& Get() {
+    static Registry* registry = new Registry();
+    return *registry;
+  }
+
+  // Zones sharing a name are merged.
+  std::size_t RegisterZone(const char* name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = zone_ids_.find(name);
+    if (it != zone_ids_.end()) {
+      return it->second;
+    }
+    if (zone_names_.size() == kMaxZones) {
+      throw std::runtime_error("[quick::Profile]: Too many profile zones.");
+    }
+    zone_names_.emplace_back(name);
+    zone_ids_.emplace(name, zone_names_.size() - 1);
+    return zone_names_.size() - 1;
+  }
+
+  ThreadCounters* RegisterThread() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.emplace_back(new ThreadCounters());
+    return threads_.back().get();
+  }
+
+  ProfileReport Merge() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ProfileZoneStats> zones(zone_names_.size());
+    std::vector<uint64_t> min_ticks(zones.size(),
+                                    std::numeric_limits<uint64_t>::max());
+    std::vector<uint64_t> max_ticks(zones.size(), 0);
+    std::vector<uint64_t> total_ticks(zones.size(), 0);
+    for (std::size_t id = 0; id < zones.size(); id++) {
+      zones[id].name = zone_names_[id];
+      zones[id].buckets.assign(kNumBuckets, 0);
+    }
+    for (auto& thread : threads_) {
+      for (std::size_t id = 0; id < zones.size(); id++) {
+        auto* counters = thread->zones[id].load(std::memory_order_acquire);
+        if (counters == nullptr) {
+          continue;
+        }
+        auto& zone = zones[id];
+        zone.count += counters->count.load(std::memory_order_relaxed);
+        total_ticks[id] += counters->total.load(std::memory_order_relaxed);
+        min_ticks[id] = std::min(min_ticks[id],
+                                 counters->min.load(std::memory_order_relaxed));
+        max_ticks[id] = std::max(max_ticks[id],
+                                 counters->max.load(std::memory_order_relaxed));
+        for (std::size_t i = 0; i < kNumBuckets; i++) {
+          zone.buckets[i] +=
+              counters->buckets[i].load(std::memory_order_relaxed);
+        }
+      }
+    }
+    ProfileReport report;
+    for (std::size_t id = 0; id < zones.size(); id++) {
+      auto& zone = zones[id];
+      if (zone.count == 0) {
+        continue;
+      }
+      zone.total_ns = CycleTimer::ToNanoSeconds(total_ticks[id]);
+      zone.min_ns = CycleTimer::ToNanoSeconds(min_ticks[id]);
+      zone.max_ns = CycleTimer::ToNanoSeconds(max_ticks[id]);
+      report.zones.push_back(std::move(zone));
+    }
+    std::sort(report.zones.begin(), report.zones.end(),
+              [](const ProfileZoneStats& a, const ProfileZoneStats& b) {
+                return a.total_ns > b.total_ns;
+              });
+    return report;
+  }
+
+ private:
+  Registry() = default;
+
+  std::mutex mutex_;
+  std::vector<std::string> zone_names_;
+  std::unordered_map<std::string, std::size_t> zone_ids_;
+  std::vector<std::unique_ptr<ThreadCounters>> threads_;
+};
+
+inline ZoneCounters& GetZoneCounters(std::size_t zone_id) {
+  thread_local ThreadCounters* thread_counters =
+      Registry::Get().RegisterThread();
+  auto& slot = thread_counters->zones[zone_id];
+  ZoneCounters* counters = slot.load(std::memory_order_relaxed);
+  if (counters == nullptr) {
+    counters = new ZoneCounters();
+    slot.store(counters, std::memory_order_release);
+  }
+  return *counters;
+}
+
+}  // namespace profile_impl
+
+// Records the time spent between its construction and destruction into the
+// zone `zone_id`. Use QUICK_PROFILE_SCOPE instead of using it directly.
+class ProfileScope {
+ public:
+  explicit ProfileScope(std::size_t zone_id)
+      : zone_id_(zone_id), start_ticks_(CycleTimer::Now()) {}
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+  ~ProfileScope() {
+    uint64_t end_ticks = CycleTimer::NowOrdered();
+    // Guards against the TSC of different cores being slightly off, in case
+    // the thread migrated.
+    uint64_t ticks = end_ticks > start_ticks_ ? end_ticks - start_ticks_ : 0;
+    profile_impl::GetZoneCounters(zone_id_).Record(ticks);
+  }
+
+ private:
+  std::size_t zone_id_;
+  uint64_t start_ticks_;
+};
+
+// Merges the counters of all the threads, so far. Thread safe, and doesn't
+// block the threads recording.
+inline ProfileReport GetProfileReport() {
+  return profile_impl::Registry::Get().Merge();
+}
+
+// Writes the profile report rendered with quick::DebugStream to `sink` every
+// `interval`, from a background thread, and once more on destruction.
+class ProfileReporter {
+ public:
+  ProfileReporter(DebugStream::Sink sink, std::chrono::milliseconds interval)
+      : sink_(std::move(sink)),
+        interval_(interval),
+        reporter_([this]() { this->Run(); }) {}
+
+  ProfileReporter(const ProfileReporter&) = delete;
+  ProfileReporter& operator=(const ProfileReporter&) = delete;
+
+  ~ProfileReporter() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    stopped_.notify_one();
+    reporter_.join();
+  }
+
+ private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      bool stop = stopped_.wait_for(lock, interval_, [this]() {
+        return stop_;
+      });
+      quick::DebugStream ds;
+      ds << GetProfileReport();
+      ds.Append('\n');
+      sink_(ds.str().data(), ds.str().size());
+      if (stop) {
+        return;
+      }
+    }
+  }
+
+  DebugStream::Sink sink_;
+  std::chrono::milliseconds interval_;
+  std::mutex mutex_;
+  std::condition_variable stopped_;
+  bool stop_ = false;
+  std::thread reporter_;
+};
+
+}  // namespace quick
+
+namespace qk = quick;
+
+#define QUICK_PROFILE_CONCAT_INTERNAL(a, b) a##b
+#define QUICK_PROFILE_CONCAT(a, b) QUICK_PROFILE_CONCAT_INTERNAL(a, b)
+
+// Profiles the rest of the enclosing scope under the zone `name` (a string
+// literal). The zone is registered once per call site.
+#define QUICK_PROFILE_SCOPE(name)                                           \
+  static const std::size_t QUICK_PROFILE_CONCAT(quick_profile_zone_,       \
+                                                __LINE__) =                 \
+      ::quick::profile_impl::Registry::Get().RegisterZone(name);            \
+  ::quick::ProfileScope QUICK_PROFILE_CONCAT(quick_profile_scope_,          \
+                                             __LINE__)(                     \
+      QUICK_PROFILE_CONCAT(quick_profile_zone_, __LINE__))
+
+#endif  // QUICK_PROFILE_HPP_
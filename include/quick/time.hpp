@@ -5,6 +5,12 @@
 #define QUICK_TIME_HPP_
 
 #include <chrono>  // NOLINT
+#include <cstdint>
+
+// Internal, undefined at the end of the header.
+#if defined(__x86_64__) || defined(__i386__)
+#define QUICK_TIME_HAS_TSC_ 1
+#endif
 
 namespace quick {
 
@@ -14,6 +20,14 @@ inline int64_t GetEpochMicroSeconds() {
   return duration_cast<microseconds>(epoch_time).count();
 }
 
+// Monotonic time in nano seconds, from an arbitrary origin. Unlike the epoch
+// time, it never jumps with clock adjustments.
+inline int64_t GetSteadyNanoSeconds() {
+  using namespace std::chrono;  // NOLINT
+  auto steady_time = steady_clock::now().time_since_epoch();
+  return duration_cast<nanoseconds>(steady_time).count();
+}
+
 class MicroSecondTimer {
  public:
   MicroSecondTimer() {this->Restart();}
@@ -30,9 +44,171 @@ class MicroSecondTimer {
   int64_t start_time;
 };
 
+// Same as MicroSecondTimer, in nano seconds from the monotonic clock.
+class NanoTimer {
+ public:
+  NanoTimer() {this->Restart();}
+  void Restart() {
+    start_time = GetSteadyNanoSeconds();
+  }
+  int64_t GetStartTime() const {
+    return start_time;
+  }
+  int64_t GetElapsedTime() const {
+    return GetSteadyNanoSeconds() - start_time;
+  }
+ private:
+  int64_t start_time;
+};
+
+namespace detail {
+
+#ifdef QUICK_TIME_HAS_TSC_
+// Inline assembly rather than <cpuid.h> / <x86intrin.h>, which would leak into
+// the includers.
+inline void Cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx,
+                  uint32_t* edx) {
+  __asm__ __volatile__("cpuid"
+                       : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                       : "a"(leaf), "c"(0));
+}
+
+inline uint64_t ReadTsc() {
+  uint32_t low, high;
+  __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+  return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+// Waits for the preceding instructions to complete.
+inline uint64_t ReadTscOrdered() {
+  uint32_t low, high, aux;
+  __asm__ __volatile__("rdtscp" : "=a"(low), "=d"(high), "=c"(aux));
+  return (static_cast<uint64_t>(high) << 32) | low;
+}
+#endif
+
+// Time stamp counter, used by CycleTimer only if it's invariant, i.e. ticks
+// at a constant rate across frequency scaling and sleep states, and rdtscp
+// is available.
+inline bool HasInvariantTsc() {
+#ifdef QUICK_TIME_HAS_TSC_
+  uint32_t eax, ebx, ecx, edx;
+  Cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+  if (eax < 0x80000007) {
+    return false;
+  }
+  Cpuid(0x80000001, &eax, &ebx, &ecx, &edx);
+  bool has_rdtscp = (edx & (1U << 27)) != 0;
+  Cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+  bool is_invariant = (edx & (1U << 8)) != 0;
+  return has_rdtscp && is_invariant;
+#else
+  return false;
+#endif
+}
+
+struct TickClock {
+  bool uses_tsc = false;
+  double nano_seconds_per_tick = 1.0;
+
+  TickClock() : uses_tsc(HasInvariantTsc()) {
+    if (uses_tsc) {
+      Calibrate();
+    }
+  }
+
+  static const TickClock& Get() {
+    static const TickClock tick_clock;
+    return tick_clock;
+  }
+
+  // Measures the TSC frequency against the steady clock over ~5ms, once per
+  // process.
+  void Calibrate() {
+#ifdef QUICK_TIME_HAS_TSC_
+    int64_t start_ns = GetSteadyNanoSeconds();
+    uint64_t start_tsc = ReadTsc();
+    int64_t end_ns;
+    do {
+      end_ns = GetSteadyNanoSeconds();
+    } while (end_ns - start_ns < 5000000);
+    uint64_t end_tsc = ReadTsc();
+    if (end_tsc <= start_tsc) {
+      uses_tsc = false;
+      return;
+    }
+    nano_seconds_per_tick = static_cast<double>(end_ns - start_ns) /
+                            static_cast<double>(end_tsc - start_tsc);
+#endif
+  }
+};
+
+}  // namespace detail
+
+// Timer for hot paths, reading the time stamp counter (rdtsc, ~10ns) when
+// it's invariant, and falling back on the monotonic clock otherwise. The TSC
+// frequency is calibrated against the monotonic clock at the first use.
+//
+// Sample usage:
+// qk::CycleTimer timer;
+// ....
+// int64_t elapsed_ns = timer.GetElapsedTime();
+class CycleTimer {
+ public:
+  CycleTimer() {this->Restart();}
+  void Restart() {
+    start_ticks = Now();
+  }
+  uint64_t GetStartTicks() const {
+    return start_ticks;
+  }
+  uint64_t GetElapsedTicks() const {
+    return NowOrdered() - start_ticks;
+  }
+  // In nano seconds.
+  int64_t GetElapsedTime() const {
+    return ToNanoSeconds(GetElapsedTicks());
+  }
+
+  // Raw ticks, either TSC cycles or nano seconds.
+  static uint64_t Now() {
+#ifdef QUICK_TIME_HAS_TSC_
+    if (UsesTsc()) {
+      return detail::ReadTsc();
+    }
+#endif
+    return static_cast<uint64_t>(GetSteadyNanoSeconds());
+  }
+
+  // Same as Now(), but waits for the preceding instructions to complete
+  // (rdtscp), for reading the end of a measured section.
+  static uint64_t NowOrdered() {
+#ifdef QUICK_TIME_HAS_TSC_
+    if (UsesTsc()) {
+      return detail::ReadTscOrdered();
+    }
+#endif
+    return static_cast<uint64_t>(GetSteadyNanoSeconds());
+  }
+
+  static int64_t ToNanoSeconds(uint64_t ticks) {
+    return static_cast<int64_t>(
+        static_cast<double>(ticks) *
+        detail::TickClock::Get().nano_seconds_per_tick);
+  }
+
+  static bool UsesTsc() {
+    return detail::TickClock::Get().uses_tsc;
+  }
+
+ private:
+  uint64_t start_ticks;
+};
+
 }  // namespace quick
 
 namespace qk = quick;
 
+#undef QUICK_TIME_HAS_TSC_
 
 #endif  // QUICK_TIME_HPP_
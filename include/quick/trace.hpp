@@ -0,0 +1,344 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#ifndef QUICK_TRACE_HPP_
+#define QUICK_TRACE_HPP_
+
+// Timeline tracing, exported in the Chrome trace_event JSON format, loadable
+// in chrome://tracing or ui.perfetto.dev. Events are timed with CycleTimer
+// and written into a ring buffer owned by the calling thread, keeping the
+// latest events of each thread. While tracing is disabled, an event costs a
+// single relaxed atomic load.
+//
+// Sample usage:
+// qk::StartTracing();
+// ....
+// void ParseRequest(...) {
+//   QUICK_TRACE_SCOPE("ParseRequest");
+//   ....
+// }
+// ....
+// qk::StopTracing();
+// qk::DebugStream ds;
+// ds.SetSink(qk::FileDescriptorSink(fd));
+// qk::ExportChromeTrace(ds);
+//
+// Event names must outlive the export, ex: string literals.
+//
+// The buffer of a thread is allocated at its first event, and is never freed,
+// even after the thread exits: `events_per_thread` events of 32 bytes each,
+// ie. 1MB per tracing thread with the default capacity.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "quick/debug_stream.hpp"
+#include "quick/time.hpp"
+
+namespace quick {
+namespace trace_impl {
+
+struct Event {
+  std::atomic<const char*> name;
+  std::atomic<uint64_t> start_ticks;
+  std::atomic<uint64_t> duration_ticks;
+  std::atomic<char> phase;
+};
+
+// Single producer ring buffer, overwriting the oldest events when full. The
+// producer claims a slot before writing it, so that a concurrent reader can
+// tell which of the events it copied may have been overwritten meanwhile.
+class ThreadBuffer {
+ public:
+  ThreadBuffer(std::size_t capacity, uint32_t thread_id)
+      : events_(new Event[capacity]()),
+        capacity_(capacity),
+        thread_id_(thread_id) {}
+
+  void Record(const char* name, char phase, uint64_t start_ticks,
+              uint64_t duration_ticks) {
+    uint64_t pos = end_.load(std::memory_order_relaxed);
+    claimed_.store(pos + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Event& event = events_[pos % capacity_];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start_ticks.store(start_ticks, std::memory_order_relaxed);
+    event.duration_ticks.store(duration_ticks, std::memory_order_relaxed);
+    event.phase.store(phase, std::memory_order_relaxed);
+    end_.store(pos + 1, std::memory_order_release);
+  }
+
+  struct EventCopy {
+    const char* name;
+    uint64_t start_ticks;
+    uint64_t duration_ticks;
+    char phase;
+  };
+
+  // Copies the events recorded since the last Clear(), oldest first.
+  std::vector<EventCopy> Copy() const {
+    uint64_t end = end_.load(std::memory_order_acquire);
+    uint64_t begin = std::max(begin_.load(std::memory_order_relaxed),
+                              end > capacity_ ? end - capacity_ : 0);
+    std::vector<EventCopy> output;
+    output.reserve(end - begin);
+    for (uint64_t pos = begin; pos < end; pos++) {
+      const Event& event = events_[pos % capacity_];
+      output.push_back({event.name.load(std::memory_order_relaxed),
+                        event.start_ticks.load(std::memory_order_relaxed),
+                        event.duration_ticks.load(std::memory_order_relaxed),
+                        event.phase.load(std::memory_order_relaxed)});
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Slots of the events before `claimed - capacity` were being overwritten.
+    uint64_t claimed = claimed_.load(std::memory_order_relaxed);
+    if (claimed > begin + capacity_) {
+      std::size_t num_torn = std::min<uint64_t>(claimed - capacity_ - begin,
+                                                output.size());
+      output.erase(output.begin(), output.begin() + num_torn);
+    }
+    return output;
+  }
+
+  void Clear() {
+    begin_.store(end_.load(std::memory_order_acquire),
+                 std::memory_order_relaxed);
+  }
+
+  uint32_t ThreadId() const {
+    return thread_id_;
+  }
+
+  // Guarded by the Registry mutex.
+  std::string thread_name;
+
+ private:
+  std::unique_ptr<Event[]> events_;
+  std::size_t capacity_;
+  uint32_t thread_id_;
+  std::atomic<uint64_t> begin_{0};
+  std::atomic<uint64_t> end_{0};
+  std::atomic<uint64_t> claimed_{0};
+};
+
+// Process wide list of thread buffers. Leaked on purpose, so that the
+// threads still running at exit can keep recording.
+class Registry {
+ public:
+  static Registry& Get() {
+    static Registry* registry = new Registry();
+    return *registry;
+  }
+
+  std::atomic<bool> enabled{false};
+
+  void Start(std::size_t events_per_thread) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_per_thread_ = std::max<std::size_t>(events_per_thread, 1);
+    origin_ticks_ = CycleTimer::Now();
+    for (auto& buffer : buffers_) {
+      buffer->Clear();
+    }
+    enabled.store(true, std::memory_order_relaxed);
+  }
+
+  ThreadBuffer* RegisterThread() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.emplace_back(new ThreadBuffer(
+        events_per_thread_, static_cast<uint32_t>(buffers_.size() + 1)));
+    return buffers_.back().get();
+  }
+
+  void SetThreadName(ThreadBuffer* buffer, const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffer->thread_name = name;
+  }
+
+  void Export(DebugStream& ds);  // NOLINT
+
+ private:
+  Registry() = default;
+
+  std::mutex mutex_;
+  std::size_t events_per_thread_ = 1 << 15;
+  uint64_t origin_ticks_ = 0;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+inline ThreadBuffer& GetThreadBuffer() {
+  thread_local ThreadBuffer* buffer = Registry::Get().RegisterThread();
+  return *buffer;
+}
+
+inline bool IsEnabled() {
+  return Registry::Get().enabled.load(std::memory_order_relaxed);
+}
+
+// Chrome expects micro seconds, printed here with nano second precision.
+inline void AppendMicroSeconds(DebugStream& ds, int64_t ns) {  // NOLINT
+  ds << ns / 1000;
+  char fraction[4] = {'.', static_cast<char>('0' + ns / 100 % 10),
+                      static_cast<char>('0' + ns / 10 % 10),
+                      static_cast<char>('0' + ns % 10)};
+  ds.Append(fraction, sizeof(fraction));
+}
+
+inline void Registry::Export(DebugStream& ds) {  // NOLINT
+  // Writing to `ds` may block (ex: on a sink), hence the events are rendered
+  // from a snapshot, without holding the lock. Buffers are never freed.
+  std::vector<std::pair<const ThreadBuffer*, std::string>> threads;
+  uint64_t origin_ticks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads.reserve(buffers_.size());
+    for (auto& buffer : buffers_) {
+      threads.emplace_back(buffer.get(), buffer->thread_name);
+    }
+    origin_ticks = origin_ticks_;
+  }
+  // Renders the strings escaped, leaving the settings of `ds` untouched.
+  DebugStream json;
+  json.SetJson(true);
+  auto append_string = [&](const char* text) {
+    json.Clear() << text;
+    ds.Append(json.str().data(), json.str().size());
+  };
+  ds.Append("{\"traceEvents\": [");
+  const int pid = static_cast<int>(getpid());
+  bool first = true;
+  auto start_event = [&](const char* name, char phase, uint32_t tid) {
+    if (not first) {
+      ds.Append(',');
+    }
+    ds.Append('\n');
+    first = false;
+    ds.Append("{\"name\": ");
+    append_string(name);
+    ds.Append(", \"ph\": \"").Append(phase).Append("\", \"pid\": ") << pid;
+    ds.Append(", \"tid\": ") << tid;
+  };
+  for (auto& thread : threads) {
+    const ThreadBuffer* buffer = thread.first;
+    if (not thread.second.empty()) {
+      start_event("thread_name", 'M', buffer->ThreadId());
+      ds.Append(", \"args\": {\"name\": ");
+      append_string(thread.second.c_str());
+      ds.Append("}}");
+    }
+    for (auto& event : buffer->Copy()) {
+      start_event(event.name, event.phase, buffer->ThreadId());
+      uint64_t start = std::max(event.start_ticks, origin_ticks);
+      ds.Append(", \"ts\": ");
+      AppendMicroSeconds(ds, CycleTimer::ToNanoSeconds(start - origin_ticks));
+      if (event.phase == 'X') {
+        ds.Append(", \"dur\": ");
+        AppendMicroSeconds(ds,
+                           CycleTimer::ToNanoSeconds(event.duration_ticks));
+      } else if (event.phase == 'i') {
+        ds.Append(", \"s\": \"t\"");
+      }
+      ds.Append('}');
+    }
+  }
+  ds.Append("\n], \"displayTimeUnit\": \"ns\"}\n");
+}
+
+}  // namespace trace_impl
+
+// Discards the events recorded so far, and starts recording. Buffers of the
+// threads tracing for the first time keep the last `events_per_thread`
+// events.
+inline void StartTracing(std::size_t events_per_thread = 1 << 15) {
+  trace_impl::Registry::Get().Start(events_per_thread);
+}
+
+// Events can still be exported after stopping.
+inline void StopTracing() {
+  trace_impl::Registry::Get().enabled.store(false, std::memory_order_relaxed);
+}
+
+inline bool IsTracingEnabled() {
+  return trace_impl::IsEnabled();
+}
+
+// Names the calling thread in the exported trace.
+inline void SetTraceThreadName(const std::string& name) {
+  trace_impl::Registry::Get().SetThreadName(&trace_impl::GetThreadBuffer(),
+                                            name);
+}
+
+// Begin / end events, for spans which don't match a C++ scope. Prefer
+// QUICK_TRACE_SCOPE otherwise, which records a single complete event.
+inline void TraceBegin(const char* name) {
+  if (trace_impl::IsEnabled()) {
+    trace_impl::GetThreadBuffer().Record(name, 'B', CycleTimer::Now(), 0);
+  }
+}
+
+inline void TraceEnd(const char* name) {
+  if (trace_impl::IsEnabled()) {
+    trace_impl::GetThreadBuffer().Record(name, 'E', CycleTimer::Now(), 0);
+  }
+}
+
+inline void TraceInstant(const char* name) {
+  if (trace_impl::IsEnabled()) {
+    trace_impl::GetThreadBuffer().Record(name, 'i', CycleTimer::Now(), 0);
+  }
+}
+
+// Records its lifetime as a complete event, if tracing was enabled at its
+// construction. Use QUICK_TRACE_SCOPE instead of using it directly.
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name)
+      : name_(trace_impl::IsEnabled() ? name : nullptr),
+        start_ticks_(name_ != nullptr ? CycleTimer::Now() : 0) {}
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+  ~TraceScope() {
+    if (name_ != nullptr) {
+      uint64_t end_ticks = CycleTimer::NowOrdered();
+      uint64_t duration = end_ticks > start_ticks_ ? end_ticks - start_ticks_
+                                                   : 0;
+      trace_impl::GetThreadBuffer().Record(name_, 'X', start_ticks_, duration);
+    }
+  }
+
+ private:
+  const char* name_;
+  uint64_t start_ticks_;
+};
+
+// Writes the recorded events of all the threads as Chrome trace_event JSON.
+// Thread safe, and doesn't block the threads recording.
+inline void ExportChromeTrace(DebugStream& ds) {  // NOLINT
+  trace_impl::Registry::Get().Export(ds);
+}
+
+inline std::string ExportChromeTrace() {
+  DebugStream ds;
+  ExportChromeTrace(ds);
+  return std::move(ds).str();
+}
+
+}  // namespace quick
+
+namespace qk = quick;
+
+#define QUICK_TRACE_CONCAT_INTERNAL(a, b) a##b
+#define QUICK_TRACE_CONCAT(a, b) QUICK_TRACE_CONCAT_INTERNAL(a, b)
+
+// Traces the rest of the enclosing scope under `name`.
+#define QUICK_TRACE_SCOPE(name)                                             \
+  ::quick::TraceScope QUICK_TRACE_CONCAT(quick_trace_scope_, __LINE__)(name)
+
+#endif  // QUICK_TRACE_HPP_
@@ -5,7 +5,12 @@
 #define QUICK_VARIANT_HPP_
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 #include <iostream>
 using std::cout;
@@ -14,15 +19,227 @@ using std::endl;
 namespace quick {
 namespace variant_impl {
 
-struct AbstractBaseType {
-  virtual ~AbstractBaseType() = default;
+// Alternatives larger than this (or over-aligned) are allocated on the heap,
+// so that a single big alternative doesn't inflate every variant.
+constexpr std::size_t kMaxInlineSize = 64;
+
+template<typename T>
+using IsStoredInline = std::integral_constant<
+                          bool, (sizeof(T) <= kMaxInlineSize &&
+                                 alignof(T) <= alignof(std::max_align_t))>;
+
+// Construct/Get/Destroy an alternative in the raw storage of the variant,
+// either in place or through an owning pointer held in the storage.
+template<typename T>
+struct InlineStorage {
+  using StoredType = T;
+  static constexpr bool kStealsOnMove = false;
+  template<typename... Args>
+  static void Construct(void* storage, Args&&... args) {
+    new (storage) T(std::forward<Args>(args)...);
+  }
+  static T& Get(void* storage) {
+    return *static_cast<T*>(storage);
+  }
+  static const T& Get(const void* storage) {
+    return *static_cast<const T*>(storage);
+  }
+  static void Destroy(void* storage) {
+    Get(storage).~T();
+  }
+  static void MoveConstruct(void* storage, void* other) {
+    Construct(storage, std::move(Get(other)));
+  }
 };
 
+// Moves steal the pointer, leaving the other variant uninitialized.
 template<typename T>
-struct TypeWrapper: AbstractBaseType {
-  T object_;
+struct HeapStorage {
+  using StoredType = T*;
+  static constexpr bool kStealsOnMove = true;
   template<typename... Args>
-  TypeWrapper(Args&&... args): object_(std::forward<Args>(args)...) {}
+  static void Construct(void* storage, Args&&... args) {
+    new (storage) T*(new T(std::forward<Args>(args)...));
+  }
+  static T& Get(void* storage) {
+    return **static_cast<T**>(storage);
+  }
+  static const T& Get(const void* storage) {
+    return **static_cast<T* const*>(storage);
+  }
+  static void Destroy(void* storage) {
+    delete *static_cast<T**>(storage);
+  }
+  static void MoveConstruct(void* storage, void* other) {
+    new (storage) T*(*static_cast<T**>(other));
+  }
+};
+
+template<typename T>
+using Storage = std::conditional_t<IsStoredInline<T>::value,
+                                   InlineStorage<T>,
+                                   HeapStorage<T>>;
+
+// Entries of the dispatch tables of quick::variant, indexed by the selected
+// alternative, so that copy, move and destroy take a single indirect call
+// regardless of the number of alternatives.
+template<typename T>
+struct Operations {
+  using S = Storage<T>;
+  static void Destroy(void* storage) {
+    S::Destroy(storage);
+  }
+  static void CopyConstruct(void* storage, const void* other) {
+    S::Construct(storage, S::Get(other));
+  }
+  static void MoveConstruct(void* storage, void* other) {
+    S::MoveConstruct(storage, other);
+  }
+  static void CopyAssign(void* storage, const void* other) {
+    S::Get(storage) = S::Get(other);
+  }
+  static void MoveAssign(void* storage, void* other) {
+    S::Get(storage) = std::move(S::Get(other));
+  }
+};
+
+// Table entry for the uninitialized variant.
+inline void DestroyNothing(void*) {}
+
+// Unchecked access to the alternatives, for visit().
+struct Access;
+
+template<typename... Ts>
+using RawStorage = std::aligned_union_t<1, typename Storage<Ts>::StoredType...>;
+
+// Smallest unsigned type holding the values [0, max_value].
+template<std::size_t max_value>
+using SmallestUnsigned = std::conditional_t<
+    (max_value <= UINT8_MAX), uint8_t,
+    std::conditional_t<(max_value <= UINT16_MAX), uint16_t, uint32_t>>;
+
+// Index of the selected alternative, sizeof...(Ts) if uninitialized. The
+// storage has no tail padding, hence the index adds its size rounded up to
+// the alignment of the storage, ex: sizeof(variant<int, float>) is 8, and
+// sizeof(variant<std::string, int>) is sizeof(std::string) + 8.
+template<typename... Ts>
+using Discriminator = SmallestUnsigned<sizeof...(Ts)>;
+
+template<bool... values>
+using AllOf = std::is_same<std::integer_sequence<bool, true, values...>,
+                           std::integer_sequence<bool, values..., true>>;
+
+// True if all the alternatives are trivially copyable and stored inline, in
+// which case the variant is trivially copyable as well.
+template<typename... Ts>
+using IsTrivialVariant = AllOf<(std::is_trivially_copyable<Ts>::value &&
+                                IsStoredInline<Ts>::value)...>;
+
+// Moves of the alternatives stored on the heap only steal the pointer, hence
+// never throw. Destructors are assumed not to throw.
+template<typename... Ts>
+using IsNothrowMoveConstructible = AllOf<
+    (not IsStoredInline<Ts>::value ||
+     std::is_nothrow_move_constructible<Ts>::value)...>;
+
+template<typename... Ts>
+using IsNothrowMoveAssignable = AllOf<
+    (not IsStoredInline<Ts>::value ||
+     (std::is_nothrow_move_constructible<Ts>::value &&
+      std::is_nothrow_move_assignable<Ts>::value))...>;
+
+// Holds the storage and implements the copy, move and destruction of
+// quick::variant.
+template<bool trivial, typename... Ts>
+class VariantBase;
+
+// Copies and moves are implicit (memberwise), i.e. a memcpy.
+template<typename... Ts>
+class VariantBase<true, Ts...> {
+ protected:
+  friend struct Access;
+  void clear() {
+    selected_type_ = sizeof...(Ts);
+  }
+  RawStorage<Ts...> storage_;
+  Discriminator<Ts...> selected_type_ = sizeof...(Ts);
+};
+
+template<typename... Ts>
+class VariantBase<false, Ts...> {
+ public:
+  VariantBase() = default;
+  VariantBase(const VariantBase& other) {
+    this->copy(other);
+  }
+  VariantBase& operator=(const VariantBase& other) {
+    this->copy(other);
+    return *this;
+  }
+  // Noexcept when possible, so that containers (ex: std::vector) move the
+  // variants on reallocation instead of copying them.
+  VariantBase(VariantBase&& other) noexcept(
+      IsNothrowMoveConstructible<Ts...>::value) {
+    this->move(other);
+  }
+  VariantBase& operator=(VariantBase&& other) noexcept(
+      IsNothrowMoveAssignable<Ts...>::value) {
+    this->move(other);
+    return *this;
+  }
+  ~VariantBase() {
+    clear();
+  }
+
+ protected:
+  friend struct Access;
+  void clear() {
+    static constexpr void (*kDestroy[])(void*) = {
+      &Operations<Ts>::Destroy..., &DestroyNothing};
+    kDestroy[selected_type_](&storage_);
+    selected_type_ = sizeof...(Ts);
+  }
+  RawStorage<Ts...> storage_;
+  Discriminator<Ts...> selected_type_ = sizeof...(Ts);
+
+ private:
+  void copy(const VariantBase& other) {
+    if (other.selected_type_ == sizeof...(Ts)) {
+      clear();
+    } else if (selected_type_ == other.selected_type_) {
+      static constexpr void (*kCopyAssign[])(void*, const void*) = {
+        &Operations<Ts>::CopyAssign...};
+      kCopyAssign[selected_type_](&storage_, &other.storage_);
+    } else {
+      static constexpr void (*kCopyConstruct[])(void*, const void*) = {
+        &Operations<Ts>::CopyConstruct...};
+      clear();
+      kCopyConstruct[other.selected_type_](&storage_, &other.storage_);
+      selected_type_ = other.selected_type_;
+    }
+  }
+  void move(VariantBase& other) {
+    static constexpr bool kStealsOnMove[] = {
+      Storage<Ts>::kStealsOnMove..., false};
+    if (other.selected_type_ == sizeof...(Ts)) {
+      clear();
+    } else if (selected_type_ == other.selected_type_ &&
+               not kStealsOnMove[selected_type_]) {
+      static constexpr void (*kMoveAssign[])(void*, void*) = {
+        &Operations<Ts>::MoveAssign...};
+      kMoveAssign[selected_type_](&storage_, &other.storage_);
+    } else {
+      static constexpr void (*kMoveConstruct[])(void*, void*) = {
+        &Operations<Ts>::MoveConstruct...};
+      auto selected = other.selected_type_;
+      clear();
+      kMoveConstruct[selected](&storage_, &other.storage_);
+      selected_type_ = selected;
+      if (kStealsOnMove[selected]) {
+        other.selected_type_ = sizeof...(Ts);
+      }
+    }
+  }
 };
 
 template<std::size_t i, typename... Ts> struct TypeListImpl;
@@ -45,108 +262,163 @@ using GetNthType = decltype(GetNthTypeFromTypeListFunc<index>(
 
 }  // namespace variant_impl
 
+// The selected alternative lives in an aligned buffer inside the variant,
+// sized for the largest alternative, hence selecting and accessing an
+// alternative doesn't allocate. Only the alternatives larger than
+// variant_impl::kMaxInlineSize are allocated on the heap. Moving those steals
+// the pointer, leaving the moved-from variant uninitialized.
+//
+// If the constructor of a newly selected alternative throws, the variant is
+// left uninitialized.
+//
+// If all the alternatives are trivially copyable and stored inline, the
+// variant is trivially copyable too, i.e. copies and moves are a memcpy.
 template<typename... Ts>
-struct variant {
+struct variant: variant_impl::VariantBase<
+                    variant_impl::IsTrivialVariant<Ts...>::value, Ts...> {
   template<std::size_t index>
   using NthType = typename variant_impl::GetNthType<index, Ts...>;
   template<std::size_t index>
-  using NthTypeWrapper = variant_impl::TypeWrapper<NthType<index>>;
-  variant() = default;
-  variant(const variant& other) {
-    this->copy(other);
-  }
-  variant& operator=(const variant& other) {
-    this->copy(other);
-    return *this;
-  }
-  variant(variant&& other) {
-    this->move(other);
-  }
-  variant& operator=(variant&& other) {
-    this->move(other);
-    return *this;
-  }
+  using NthStorage = variant_impl::Storage<NthType<index>>;
+  // Selects the alternative `index`, constructing it from `args` if it isn't
+  // already selected.
   template<std::size_t index, typename... Args>
-  constexpr NthType<index>& at(Args&&... args) {
-    if (ptr == nullptr || selected_type_ != index) {
-      ptr.reset(new NthTypeWrapper<index>(std::forward<Args>(args)...));
+  NthType<index>& at(Args&&... args) {
+    if (this->selected_type_ != index) {
+      clear();
+      NthStorage<index>::Construct(&this->storage_,
+                                   std::forward<Args>(args)...);
+      this->selected_type_ = index;
     }
-    selected_type_ = index;
-    return static_cast<NthTypeWrapper<index>&>(*ptr).object_;
+    return NthStorage<index>::Get(&this->storage_);
   }
   template<std::size_t index>
-  constexpr const NthType<index>& at() const {
-    if (ptr == nullptr || selected_type_ != index) {
+  const NthType<index>& at() const {
+    if (this->selected_type_ != index) {
       throw std::runtime_error("[quick::variant]: const access is not allowed "
                                "if corrosponding type is not already set");
     }
-    return static_cast<const NthTypeWrapper<index>&>(*ptr).object_;
+    return NthStorage<index>::Get(&this->storage_);
   }
   void clear() {
-    ptr.reset(nullptr);
+    variant::VariantBase::clear();
   }
   bool initialized() const {
-    return (ptr != nullptr);
+    return (this->selected_type_ != sizeof...(Ts));
   }
   std::size_t selected_type() const {
-    if (ptr == nullptr) {
-      return sizeof...(Ts);
-    } else {
-      return selected_type_;
-    }
+    return this->selected_type_;
   }
+};
 
- private:
-  void copy(const variant& other) {
-    if (other.ptr == nullptr) {
-      ptr.reset(nullptr);
-      return;
-    }
-    copy_impl_type<0, Ts...>(other);
+namespace variant_impl {
+
+struct Access {
+  template<std::size_t index, typename... Ts>
+  static auto& Get(variant<Ts...>& input) {
+    using S = typename variant<Ts...>::template NthStorage<index>;
+    return S::Get(&input.storage_);
+  }
+  template<std::size_t index, typename... Ts>
+  static auto& Get(const variant<Ts...>& input) {
+    using S = typename variant<Ts...>::template NthStorage<index>;
+    return S::Get(&input.storage_);
   }
-  void move(variant& other) {
-    if (other.ptr == nullptr) {
-      ptr.reset(nullptr);
-      return;
+  template<std::size_t index, typename... Ts>
+  static auto&& Get(variant<Ts...>&& input) {
+    using S = typename variant<Ts...>::template NthStorage<index>;
+    return std::move(S::Get(&input.storage_));
+  }
+};
+
+template<typename V> struct VariantSize;
+
+template<typename... Ts>
+struct VariantSize<variant<Ts...>>
+    : std::integral_constant<std::size_t, sizeof...(Ts)> {};
+
+// Visits `Vs...` (references to variants) through a single table of
+// function pointers, with an entry for each combination of alternatives,
+// laid out in row-major order.
+template<typename F, typename... Vs>
+struct Visitor {
+  static_assert(sizeof...(Vs) > 0, "visit requires at least one variant");
+  using R = decltype(std::declval<F>()(
+                        Access::Get<0>(std::declval<Vs>())...));
+  using Function = R (*)(F&&, Vs&&...);
+
+  static constexpr std::size_t NumEntries() {
+    const std::size_t sizes[] = {VariantSize<std::decay_t<Vs>>::value...};
+    std::size_t output = 1;
+    for (std::size_t size : sizes) {
+      output *= size;
     }
-    move_impl_type<0, Ts...>(other);
-  }
-  template<std::size_t index, typename S, typename... Ss>
-  void copy_impl_type(const variant& other) {
-    if (index == other.selected_type_) {
-      using WT = variant_impl::TypeWrapper<S>;
-      if (ptr == nullptr || selected_type_ != index) {
-        ptr.reset(new WT(static_cast<const WT&>(*other.ptr).object_));
-        selected_type_ = index;
-      } else {
-        const auto& other_ref = static_cast<const WT&>(*other.ptr).object_;
-        static_cast<WT&>(*ptr).object_ = other_ref;
-      }
+    return output;
+  }
+
+  // Alternative of the `k`th variant for the table entry `entry`.
+  static constexpr std::size_t AlternativeIndex(std::size_t entry,
+                                                std::size_t k) {
+    const std::size_t sizes[] = {VariantSize<std::decay_t<Vs>>::value...};
+    for (std::size_t j = sizeof...(Vs); j > k + 1; j--) {
+      entry /= sizes[j - 1];
     }
-    copy_impl_type<index+1, Ss...>(other);
-  }
-  template<std::size_t index, typename S, typename... Ss>
-  void move_impl_type(variant& other) {
-    if (index == other.selected_type_) {
-      using WT = variant_impl::TypeWrapper<S>;
-      if (ptr == nullptr || selected_type_ != index) {
-        ptr.reset(new WT(std::move(static_cast<WT&&>(*other.ptr).object_)));
-        selected_type_ = index;
-      } else {
-        auto&& other_ref = static_cast<WT&&>(*other.ptr).object_;
-        static_cast<WT&>(*ptr).object_ = std::move(other_ref);
+    return entry % sizes[k];
+  }
+
+  template<std::size_t entry, std::size_t... k>
+  static R Call(std::index_sequence<k...>, F&& f, Vs&&... vs) {
+    return std::forward<F>(f)(Access::Get<AlternativeIndex(entry, k)>(
+                                  std::forward<Vs>(vs))...);
+  }
+
+  template<std::size_t entry>
+  static R Entry(F&& f, Vs&&... vs) {
+    return Call<entry>(std::index_sequence_for<Vs...>(),
+                       std::forward<F>(f),
+                       std::forward<Vs>(vs)...);
+  }
+
+  template<std::size_t... entries>
+  static R Dispatch(std::size_t entry,
+                    std::index_sequence<entries...>,
+                    F&& f,
+                    Vs&&... vs) {
+    static constexpr Function kTable[] = {&Entry<entries>...};
+    return kTable[entry](std::forward<F>(f), std::forward<Vs>(vs)...);
+  }
+
+  static R Visit(F&& f, Vs&&... vs) {
+    const std::size_t sizes[] = {VariantSize<std::decay_t<Vs>>::value...};
+    const std::size_t selected[] = {vs.selected_type()...};
+    std::size_t entry = 0;
+    for (std::size_t k = 0; k < sizeof...(Vs); k++) {
+      if (selected[k] == sizes[k]) {
+        throw std::runtime_error("[quick::variant]: visit is not allowed on "
+                                 "an uninitialized variant");
       }
+      entry = entry * sizes[k] + selected[k];
     }
-    move_impl_type<index+1, Ss...>(other);
+    return Dispatch(entry,
+                    std::make_index_sequence<NumEntries()>(),
+                    std::forward<F>(f),
+                    std::forward<Vs>(vs)...);
   }
-  template<std::size_t index>
-  void copy_impl_type(const variant& other) {}
-  template<std::size_t index>
-  void move_impl_type(variant& other) {}
-  std::unique_ptr<quick::variant_impl::AbstractBaseType> ptr;
-  std::size_t selected_type_ = sizeof...(Ts);
 };
 
+}  // namespace variant_impl
+
+// Calls `f` with the selected alternatives of `vs...`, ex:
+// `quick::visit([](const auto& x, const auto& y) {...}, v1, v2)`, through a
+// table of function pointers, hence in constant time. `f` must return the
+// same type for every combination of alternatives. Throws if any of the
+// variants is uninitialized.
+template<typename F, typename... Vs>
+decltype(auto) visit(F&& f, Vs&&... vs) {
+  return variant_impl::Visitor<F, Vs...>::Visit(std::forward<F>(f),
+                                                std::forward<Vs>(vs)...);
+}
+
 }  // namespace quick
 
 namespace qk = quick;
@@ -3,11 +3,144 @@
 
 #include "quick/file_utils.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>  // NOLINT
+#include <cstring>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <random>
+#include <stdexcept>
+#include <thread>  // NOLINT
+#include <unordered_set>
+#include <vector>
+
+// io_uring is used through raw system calls. IORING_FEAT_RW_CUR_POS comes
+// with IORING_OP_READ / IORING_OP_WRITE (Linux 5.6).
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define QUICK_HAS_IO_URING 1
+#endif
+#endif
+#endif
 
 namespace quick {
 
 using std::string;
 
+namespace {
+
+// Closes the file descriptor when going out of scope.
+class ScopedFileDescriptor {
+ public:
+  explicit ScopedFileDescriptor(int fd): fd_(fd) {}
+  ScopedFileDescriptor(const ScopedFileDescriptor&) = delete;
+  ScopedFileDescriptor& operator=(const ScopedFileDescriptor&) = delete;
+  ~ScopedFileDescriptor() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+  int get() const {
+    return fd_;
+  }
+
+ private:
+  int fd_;
+};
+
+// Bounds a single read(2), which transfers at most ~2GB on Linux anyway.
+constexpr std::size_t kMaxReadSize = std::size_t(1) << 30;
+
+// Reads until `size` bytes are read or the end of the file, retrying on short
+// reads and EINTR. Returns the number of bytes read, or -1 on error.
+ssize_t ReadFully(int fd, char* data, std::size_t size) {
+  std::size_t done = 0;
+  while (done < size) {
+    ssize_t num_read = read(fd, data + done,
+                            std::min(size - done, kMaxReadSize));
+    if (num_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (num_read == 0) {
+      break;
+    }
+    done += num_read;
+  }
+  return done;
+}
+
+// A single read(2), retried on EINTR. Returns 0 at the end of the file.
+ssize_t ReadSome(int fd, char* data, std::size_t size) {
+  ssize_t num_read;
+  do {
+    num_read = read(fd, data, size);
+  } while (num_read < 0 && errno == EINTR);
+  return num_read;
+}
+
+// Writes all of `data`, retrying on short writes and EINTR.
+bool WriteFully(int fd, const char* data, std::size_t size) {
+  std::size_t done = 0;
+  while (done < size) {
+    ssize_t num_written = write(fd, data + done,
+                                std::min(size - done, kMaxReadSize));
+    if (num_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    done += num_written;
+  }
+  return true;
+}
+
+string DirectoryName(const string& file_name) {
+  auto pos = file_name.find_last_of('/');
+  if (pos == string::npos) {
+    return ".";
+  }
+  return pos == 0 ? "/" : file_name.substr(0, pos);
+}
+
+// Creates a new file next to `file_name`, named uniquely among the threads of
+// this process. A name taken already, ex: left by a crashed process with the
+// same pid, is retried with a random suffix, like mkstemp(3). Returns the
+// file descriptor, or -1 on failure.
+int CreateTemporaryFile(const string& file_name, string* temp_file_name) {
+  static std::atomic<uint64_t> counter(0);
+  string name = file_name + ".tmp." + std::to_string(getpid()) + "." +
+                std::to_string(counter.fetch_add(1, std::memory_order_relaxed));
+  for (int attempt = 0; attempt < 100; attempt++) {
+    *temp_file_name = name;
+    if (attempt > 0) {
+      thread_local std::mt19937_64 generator(std::random_device{}());
+      *temp_file_name += "." + std::to_string(generator());
+    }
+    int fd = open(temp_file_name->c_str(),
+                  O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (fd >= 0 || errno != EEXIST) {
+      return fd;
+    }
+  }
+  return -1;
+}
+
+}  // namespace
+
 FileException::FileException() {
   this->BuildErrorMessage();
 }
@@ -34,30 +167,90 @@ void FileException::BuildErrorMessage() {
     case FAILED_TO_WRITE:
       oss << "FAILED_TO_WRITE: \"" << file_name << "\"";
       break;
+    case FAILED_TO_READ:
+      oss << "FAILED_TO_READ: \"" << file_name << "\"";
+      break;
     default: break;
   }
   oss << "\n";
   this-> error_message = oss.str();
 }
 
+// The output is sized from fstat and filled in place, instead of growing a
+// stream buffer and copying it. Files whose size isn't known upfront (pipes,
+// /proc files) or which grow meanwhile are read in growing chunks.
 std::string ReadFile(const std::string& file_name) {
-  std::ifstream fd(file_name);
-  if (!fd) {
+  ScopedFileDescriptor fd(open(file_name.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd.get() < 0) {
     throw FileException(FileException::FAILED_TO_OPEN, file_name);
   }
-  std::stringstream buffer;
-  buffer << fd.rdbuf();
-  fd.close();
-  return buffer.str();
+  struct stat file_stat;
+  std::size_t expected_size = 0;
+  if (fstat(fd.get(), &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+    expected_size = file_stat.st_size;
+  }
+  string output(expected_size, '\0');
+  ssize_t num_read = ReadFully(fd.get(), &output[0], expected_size);
+  if (num_read < 0) {
+    throw FileException(FileException::FAILED_TO_READ, file_name);
+  }
+  if (static_cast<std::size_t>(num_read) < expected_size) {
+    output.resize(num_read);
+    return output;
+  }
+  // Checks for the end of the file without growing the output first.
+  char chunk[64 * 1024];
+  while ((num_read = ReadFully(fd.get(), chunk, sizeof(chunk))) > 0) {
+    output.append(chunk, num_read);
+  }
+  if (num_read < 0) {
+    throw FileException(FileException::FAILED_TO_READ, file_name);
+  }
+  return output;
 }
 
 void WriteFile(const std::string& file_name, const std::string& content) {
-  std::ofstream fd(file_name);
-  if (!fd) {
+  ScopedFileDescriptor fd(open(file_name.c_str(),
+                               O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                               0666));
+  if (fd.get() < 0 || not WriteFully(fd.get(), content.data(),
+                                     content.size())) {
     throw FileException(FileException::FAILED_TO_WRITE, file_name);
   }
-  fd << content;
-  fd.close();
+}
+
+void WriteFileAtomically(const std::string& file_name,
+                         const std::string& content,
+                         FileDurability durability) {
+  string temp_file_name;
+  int fd = CreateTemporaryFile(file_name, &temp_file_name);
+  if (fd < 0) {
+    throw FileException(FileException::FAILED_TO_WRITE, file_name);
+  }
+  struct stat file_stat;
+  bool ok = true;
+  if (stat(file_name.c_str(), &file_stat) == 0) {
+    ok = (fchmod(fd, file_stat.st_mode & 07777) == 0);
+  }
+  ok = ok && WriteFully(fd, content.data(), content.size());
+  if (ok && durability != FileDurability::NONE) {
+    ok = (fdatasync(fd) == 0);
+  }
+  // Delayed write errors may be reported by close(2) only.
+  ok = (close(fd) == 0) && ok;
+  ok = ok && (rename(temp_file_name.c_str(), file_name.c_str()) == 0);
+  if (not ok) {
+    unlink(temp_file_name.c_str());
+    throw FileException(FileException::FAILED_TO_WRITE, file_name);
+  }
+  if (durability == FileDurability::FULL) {
+    string directory = DirectoryName(file_name);
+    ScopedFileDescriptor directory_fd(
+        open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (directory_fd.get() < 0 || fsync(directory_fd.get()) != 0) {
+      throw FileException(FileException::FAILED_TO_WRITE, file_name);
+    }
+  }
 }
 
 bool DoesFileExist(const std::string& file_name) {
@@ -65,8 +258,796 @@ bool DoesFileExist(const std::string& file_name) {
     return infile.good();
 }
 
+MappedFile::MappedFile(const std::string& file_name,
+                       const MappedFileOptions& options) {
+  ScopedFileDescriptor fd(open(file_name.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd.get() < 0) {
+    throw FileException(FileException::FAILED_TO_OPEN, file_name);
+  }
+  struct stat file_stat;
+  if (fstat(fd.get(), &file_stat) != 0 || not S_ISREG(file_stat.st_mode)) {
+    throw FileException(FileException::FAILED_TO_READ, file_name);
+  }
+  // mmap(2) rejects empty mappings.
+  if (file_stat.st_size == 0) {
+    return;
+  }
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  if (options.populate) {
+    flags |= MAP_POPULATE;
+  }
+#endif
+  void* address = mmap(nullptr, file_stat.st_size, PROT_READ, flags,
+                       fd.get(), 0);
+  if (address == MAP_FAILED) {
+    throw FileException(FileException::FAILED_TO_READ, file_name);
+  }
+  data_ = static_cast<const char*>(address);
+  size_ = file_stat.st_size;
+  // The hints are best effort, hence their failures are ignored.
+  if (options.access_pattern == MappedFileOptions::SEQUENTIAL) {
+    madvise(address, size_, MADV_SEQUENTIAL);
+  } else if (options.access_pattern == MappedFileOptions::RANDOM) {
+    madvise(address, size_, MADV_RANDOM);
+  }
+#ifdef MADV_HUGEPAGE
+  if (options.huge_pages) {
+    madvise(address, size_, MADV_HUGEPAGE);
+  }
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(other.data_), size_(other.size_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    Unmap();
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+  }
+  return *this;
+}
 
-}  // namespace quick
+MappedFile::~MappedFile() {
+  Unmap();
+}
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+// Double buffering: a thread reads the next chunk into one buffer while the
+// other one is being parsed.
+class LineReader::Readahead {
+ public:
+  Readahead(int fd, std::size_t buffer_size)
+      : fd_(fd), buffer_size_(buffer_size) {
+    for (auto& slot : slots_) {
+      slot.data.reset(new char[buffer_size]);
+    }
+    thread_ = std::thread([this]() { this->Run(); });
+  }
 
+  ~Readahead() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    slot_changed_.notify_all();
+    thread_.join();
+  }
+
+  // Releases the chunk returned last time, and returns the next one, or -1
+  // on read error. Returns 0 at the end of the file.
+  ssize_t Next(const char** data) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (consumer_slot_ >= 0) {
+      slots_[consumer_slot_].is_full = false;
+      slot_changed_.notify_all();
+    }
+    consumer_slot_ = (consumer_slot_ + 1) % 2;
+    Slot& slot = slots_[consumer_slot_];
+    slot_changed_.wait(lock, [&slot]() { return slot.is_full; });
+    *data = slot.data.get();
+    return slot.size;
+  }
+
+ private:
+  struct Slot {
+    std::unique_ptr<char[]> data;
+    ssize_t size = 0;
+    bool is_full = false;
+  };
+
+  // Stops after the end of the file or an error.
+  void Run() {
+    for (int i = 0; ; i = (i + 1) % 2) {
+      Slot& slot = slots_[i];
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        slot_changed_.wait(lock, [this, &slot]() {
+          return stop_ || not slot.is_full;
+        });
+        if (stop_) {
+          return;
+        }
+      }
+      ssize_t size = ReadSome(fd_, slot.data.get(), buffer_size_);
+      std::lock_guard<std::mutex> lock(mutex_);
+      slot.size = size;
+      slot.is_full = true;
+      slot_changed_.notify_all();
+      if (size <= 0) {
+        return;
+      }
+    }
+  }
+
+  int fd_;
+  std::size_t buffer_size_;
+  Slot slots_[2];
+  int consumer_slot_ = -1;
+  bool stop_ = false;
+  std::mutex mutex_;
+  std::condition_variable slot_changed_;
+  std::thread thread_;
+};
+
+LineReader::LineReader(const std::string& file_name,
+                       const LineReaderOptions& options)
+    : file_name_(file_name),
+      fd_(open(file_name.c_str(), O_RDONLY | O_CLOEXEC)),
+      buffer_size_(std::min(std::max<std::size_t>(options.buffer_size, 1),
+                            kMaxReadSize)) {
+  if (fd_ < 0) {
+    throw FileException(FileException::FAILED_TO_OPEN, file_name);
+  }
+  // Best effort: enlarges the kernel readahead window.
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+  // Reads from pipes and FIFOs may block indefinitely, and the destructor
+  // waits for the pending read.
+  struct stat file_stat;
+  if (options.readahead && fstat(fd_, &file_stat) == 0 &&
+      S_ISREG(file_stat.st_mode)) {
+    readahead_.reset(new Readahead(fd_, buffer_size_));
+  } else {
+    buffer_.reset(new char[buffer_size_]);
+  }
+}
 
+LineReader::~LineReader() {
+  readahead_.reset();
+  close(fd_);
+}
+
+bool LineReader::Next(const char*& data, std::size_t& size) {  // NOLINT
+  // memchr is vectorized by the libc (SSE2 / AVX2 on x86-64).
+  auto newline = static_cast<const char*>(
+      pos_ < end_ ? std::memchr(pos_, '\n', end_ - pos_) : nullptr);
+  if (newline != nullptr) {
+    data = pos_;
+    size = newline - pos_;
+    pos_ = newline + 1;
+    return true;
+  }
+  carry_.assign(pos_, end_);
+  while (NextChunk()) {
+    newline = static_cast<const char*>(std::memchr(pos_, '\n',
+                                                   end_ - pos_));
+    if (newline == nullptr) {
+      carry_.append(pos_, end_);
+      continue;
+    }
+    if (carry_.empty()) {
+      data = pos_;
+      size = newline - pos_;
+    } else {
+      carry_.append(pos_, newline);
+      data = carry_.data();
+      size = carry_.size();
+    }
+    pos_ = newline + 1;
+    return true;
+  }
+  pos_ = end_ = nullptr;
+  if (carry_.empty()) {
+    return false;
+  }
+  data = carry_.data();
+  size = carry_.size();
+  return true;
+}
 
+bool LineReader::Next(std::string& line) {  // NOLINT
+  const char* data;
+  std::size_t size;
+  if (not Next(data, size)) {
+    return false;
+  }
+  line.assign(data, size);
+  return true;
+}
+
+bool LineReader::NextChunk() {
+  if (eof_) {
+    return false;
+  }
+  const char* data = buffer_.get();
+  ssize_t size = readahead_ ? readahead_->Next(&data)
+                            : ReadSome(fd_, buffer_.get(), buffer_size_);
+  eof_ = (size <= 0);
+  if (size < 0) {
+    throw FileException(FileException::FAILED_TO_READ, file_name_);
+  }
+  pos_ = data;
+  end_ = data + size;
+  return not eof_;
+}
+
+class AsyncFileIO::Executor {
+ public:
+  virtual ~Executor() = default;
+  virtual void Read(const string& file_name, ReadCallback callback) = 0;
+  virtual void Write(const string& file_name, string content,
+                     WriteCallback callback) = 0;
+  virtual AsyncFileIOOptions::Backend backend() const = 0;
+};
+
+namespace {
+
+// Runs the blocking ReadFile / WriteFile on worker threads.
+class ThreadPoolExecutor : public AsyncFileIO::Executor {
+ public:
+  explicit ThreadPoolExecutor(std::size_t num_threads) {
+    for (std::size_t i = 0; i < std::max<std::size_t>(num_threads, 1); i++) {
+      workers_.emplace_back([this]() { this->RunWorker(); });
+    }
+  }
+
+  ~ThreadPoolExecutor() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    has_tasks_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  void Read(const string& file_name,
+            AsyncFileIO::ReadCallback callback) override {
+    Enqueue([file_name, callback]() {
+      string content;
+      std::exception_ptr error;
+      try {
+        content = ReadFile(file_name);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      callback(std::move(content), error);
+    });
+  }
+
+  void Write(const string& file_name, string content,
+             AsyncFileIO::WriteCallback callback) override {
+    auto shared_content = std::make_shared<string>(std::move(content));
+    Enqueue([file_name, shared_content, callback]() {
+      std::exception_ptr error;
+      try {
+        WriteFile(file_name, *shared_content);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      callback(error);
+    });
+  }
+
+  AsyncFileIOOptions::Backend backend() const override {
+    return AsyncFileIOOptions::THREAD_POOL;
+  }
+
+ private:
+  void Enqueue(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    has_tasks_.notify_one();
+  }
+
+  // Exits once stopped and all the tasks are done.
+  void RunWorker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      has_tasks_.wait(lock, [this]() { return stop_ || not tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      auto task = std::move(tasks_.front());
+      tasks_.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable has_tasks_;
+  std::deque<std::function<void()>> tasks_;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+};
+
+#ifdef QUICK_HAS_IO_URING
+
+// io_uring through raw system calls, without depending on liburing. Requests
+// are submitted by the calling threads, and a reaper thread handles the
+// completions: it resubmits the remainder of short reads and writes, and
+// finishes the requests by closing the files and calling the callbacks.
+class IoUringExecutor : public AsyncFileIO::Executor {
+ public:
+  // Returns nullptr if the kernel doesn't support io_uring, or lacks
+  // IORING_OP_READ / IORING_OP_WRITE (before 5.6).
+  static std::unique_ptr<AsyncFileIO::Executor> Create(
+      std::size_t queue_depth) {
+    std::unique_ptr<IoUringExecutor> executor(new IoUringExecutor());
+    if (not executor->Setup(queue_depth)) {
+      return nullptr;
+    }
+    IoUringExecutor* raw_executor = executor.get();
+    executor->reaper_ = std::thread([raw_executor]() {
+      raw_executor->RunReaper();
+    });
+    return executor;
+  }
+
+  ~IoUringExecutor() override {
+    if (reaper_.joinable()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      idle_.wait(lock, [this]() {
+        return in_flight_.empty() && pending_.empty();
+      });
+      // Wakes up the reaper, which exits on a null request, unless it exited
+      // already on an error. Nothing is in flight, hence the submission may
+      // fail only transiently, ex: while the reaper drains the completions.
+      while (not failed_ &&
+             not PushSqe(IORING_OP_NOP, -1, nullptr, 0, 0, nullptr)) {
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+      }
+      lock.unlock();
+      reaper_.join();
+    }
+    if (sqes_ != nullptr) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+      close(ring_fd_);
+    }
+    for (auto* request : abandoned_) {
+      delete request;
+    }
+  }
+
+  void Read(const string& file_name,
+            AsyncFileIO::ReadCallback callback) override {
+    int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      callback(string(), std::make_exception_ptr(
+          FileException(FileException::FAILED_TO_OPEN, file_name)));
+      return;
+    }
+    std::unique_ptr<Request> request(new Request());
+    request->is_read = true;
+    request->file_name = file_name;
+    request->fd = fd;
+    struct stat file_stat;
+    // Files of unknown size (pipes, /proc files) are read in growing chunks.
+    request->size_known = (fstat(fd, &file_stat) == 0 &&
+                           S_ISREG(file_stat.st_mode) &&
+                           file_stat.st_size > 0);
+    request->buffer.resize(request->size_known ? file_stat.st_size
+                                               : kUnknownSizeChunk);
+    request->read_callback = std::move(callback);
+    Submit(request.release());
+  }
+
+  void Write(const string& file_name, string content,
+             AsyncFileIO::WriteCallback callback) override {
+    int fd = open(file_name.c_str(),
+                  O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+      callback(std::make_exception_ptr(
+          FileException(FileException::FAILED_TO_WRITE, file_name)));
+      return;
+    }
+    std::unique_ptr<Request> request(new Request());
+    request->is_read = false;
+    request->file_name = file_name;
+    request->fd = fd;
+    request->buffer = std::move(content);
+    request->write_callback = std::move(callback);
+    Submit(request.release());
+  }
+
+  AsyncFileIOOptions::Backend backend() const override {
+    return AsyncFileIOOptions::IO_URING;
+  }
+
+ private:
+  static constexpr std::size_t kUnknownSizeChunk = 64 * 1024;
+
+  struct Request {
+    bool is_read;
+    bool size_known = false;
+    string file_name;
+    int fd;
+    string buffer;
+    std::size_t done = 0;
+    AsyncFileIO::ReadCallback read_callback;
+    AsyncFileIO::WriteCallback write_callback;
+  };
+
+  IoUringExecutor() = default;
+
+  bool Setup(std::size_t queue_depth) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    unsigned entries = static_cast<unsigned>(
+        std::min<std::size_t>(std::max<std::size_t>(queue_depth, 1), 4096));
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries,
+                                        &params));
+    if (ring_fd_ < 0 || (params.features & IORING_FEAT_RW_CUR_POS) == 0) {
+      return false;
+    }
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes +
+                    params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = MapRing(sq_ring_size_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == nullptr) {
+      return false;
+    }
+    cq_ring_ = single_mmap ? sq_ring_
+                           : MapRing(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = MapRing(sqes_size_, IORING_OFF_SQES);
+    if (cq_ring_ == nullptr || sqes == nullptr) {
+      return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+    char* sq_ring = static_cast<char*>(sq_ring_);
+    char* cq_ring = static_cast<char*>(cq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+    // The completion queue is twice as large, hence never overflows.
+    max_in_flight_ = std::min<std::size_t>(
+        std::max<std::size_t>(queue_depth, 1), params.sq_entries);
+    return true;
+  }
+
+  void* MapRing(std::size_t size, off_t offset) {
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+    return address == MAP_FAILED ? nullptr : address;
+  }
+
+  void Submit(Request* request) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (not failed_) {
+        if (in_flight_.size() >= max_in_flight_) {
+          pending_.push_back(request);
+          return;
+        }
+        in_flight_.insert(request);
+        if (PushRequest(request)) {
+          return;
+        }
+        // Nothing is pending, since there was room.
+        in_flight_.erase(request);
+        if (in_flight_.empty()) {
+          idle_.notify_all();
+        }
+      }
+    }
+    Respond(request, false);
+    delete request;
+  }
+
+  // Resubmits the remainder of the transfer, or fails the request. Called by
+  // the reaper.
+  void Resubmit(Request* request) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (PushRequest(request)) {
+        return;
+      }
+    }
+    Finish(request, false);
+  }
+
+  // Submits the remaining part of the transfer. Requires `mutex_`. Returns
+  // false on failure.
+  bool PushRequest(Request* request) {
+    std::size_t length = std::min(request->buffer.size() - request->done,
+                                  kMaxReadSize);
+    return PushSqe(request->is_read ? IORING_OP_READ : IORING_OP_WRITE,
+                   request->fd, &request->buffer[0] + request->done, length,
+                   request->done, request);
+  }
+
+  // Requires `mutex_`. The submission queue can't be full, since every
+  // entry is either consumed by io_uring_enter right away, or withdrawn if
+  // io_uring_enter fails. Returns false on failure, with errno set.
+  bool PushSqe(uint8_t opcode, int fd, char* address, std::size_t length,
+               uint64_t offset, Request* request) {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(address);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->off = offset;
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    while (syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0) < 0) {
+      if (errno != EINTR && errno != EAGAIN) {
+        // Nothing was consumed, ex: EBUSY while the completion queue
+        // overflows.
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void RunReaper() {
+    while (true) {
+      if (syscall(__NR_io_uring_enter, ring_fd_, 0, 1,
+                  IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        FailAll();
+        return;
+      }
+      unsigned head = *cq_head_;
+      unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      {
+        // The requests were written under `mutex_` before being submitted.
+        // Acquiring it once per batch makes that ordering explicit, rather
+        // than relying on the system calls in between.
+        std::lock_guard<std::mutex> lock(mutex_);
+      }
+      for (; head != tail; head++) {
+        const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+        auto* request = reinterpret_cast<Request*>(cqe.user_data);
+        int result = cqe.res;
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        if (request == nullptr) {
+          return;
+        }
+        HandleCompletion(request, result);
+      }
+    }
+  }
+
+  void HandleCompletion(Request* request, int result) {
+    if (result == -EINTR || result == -EAGAIN) {
+      Resubmit(request);
+      return;
+    }
+    if (result < 0 || (result == 0 && not request->is_read &&
+                       request->done < request->buffer.size())) {
+      Finish(request, false);
+      return;
+    }
+    request->done += result;
+    bool is_done = (request->done == request->buffer.size());
+    if (request->is_read) {
+      if (result == 0 || (is_done && request->size_known)) {
+        request->buffer.resize(request->done);
+        Finish(request, true);
+        return;
+      }
+      if (is_done) {
+        request->buffer.resize(request->buffer.size() * 2);
+      }
+    } else if (is_done) {
+      Finish(request, true);
+      return;
+    }
+    Resubmit(request);
+  }
+
+  // The completions can't be waited for anymore, hence fails all the requests,
+  // and the later ones right away. The in-flight requests are deleted only
+  // after closing the ring, since the kernel may still use their buffers.
+  void FailAll() {
+    std::deque<Request*> pending;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      failed_ = true;
+      abandoned_.assign(in_flight_.begin(), in_flight_.end());
+      in_flight_.clear();
+      pending.swap(pending_);
+    }
+    for (auto* request : abandoned_) {
+      Respond(request, false);
+    }
+    for (auto* request : pending) {
+      Respond(request, false);
+      delete request;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.notify_all();
+  }
+
+  // Called by the reaper.
+  void Finish(Request* request, bool ok) {
+    Respond(request, ok);
+    std::vector<Request*> failed;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      in_flight_.erase(request);
+      // Starts the next pending request, failing those not submitted.
+      while (not pending_.empty()) {
+        Request* next = pending_.front();
+        pending_.pop_front();
+        in_flight_.insert(next);
+        if (PushRequest(next)) {
+          break;
+        }
+        in_flight_.erase(next);
+        failed.push_back(next);
+      }
+    }
+    delete request;
+    for (auto* next : failed) {
+      Respond(next, false);
+      delete next;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (in_flight_.empty() && pending_.empty()) {
+      idle_.notify_all();
+    }
+  }
+
+  // Closes the file and calls the callback.
+  void Respond(Request* request, bool ok) {
+    // Delayed write errors may be reported by close(2) only.
+    ok = (close(request->fd) == 0) && ok;
+    std::exception_ptr error;
+    if (not ok) {
+      error = std::make_exception_ptr(FileException(
+          request->is_read ? FileException::FAILED_TO_READ
+                           : FileException::FAILED_TO_WRITE,
+          request->file_name));
+    }
+    if (request->is_read) {
+      request->read_callback(ok ? std::move(request->buffer) : string(),
+                             error);
+    } else {
+      request->write_callback(error);
+    }
+  }
+
+  int ring_fd_ = -1;
+  void* sq_ring_ = nullptr;
+  void* cq_ring_ = nullptr;
+  std::size_t sq_ring_size_ = 0;
+  std::size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  std::size_t sqes_size_ = 0;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  std::mutex mutex_;
+  std::condition_variable idle_;
+  std::size_t max_in_flight_ = 0;
+  std::unordered_set<Request*> in_flight_;
+  std::deque<Request*> pending_;
+  // Set once the reaper exited on an error.
+  bool failed_ = false;
+  std::vector<Request*> abandoned_;
+  std::thread reaper_;
+};
+
+constexpr std::size_t IoUringExecutor::kUnknownSizeChunk;
+
+#endif  // QUICK_HAS_IO_URING
+
+}  // namespace
+
+AsyncFileIO::AsyncFileIO(const AsyncFileIOOptions& options) {
+#ifdef QUICK_HAS_IO_URING
+  if (options.backend != AsyncFileIOOptions::THREAD_POOL) {
+    executor_ = IoUringExecutor::Create(options.queue_depth);
+  }
+#endif
+  if (executor_ == nullptr) {
+    if (options.backend == AsyncFileIOOptions::IO_URING) {
+      throw std::runtime_error("[quick::AsyncFileIO]: io_uring is not "
+                               "supported.");
+    }
+    executor_.reset(new ThreadPoolExecutor(options.num_threads));
+  }
+}
+
+AsyncFileIO::~AsyncFileIO() = default;
+
+void AsyncFileIO::Read(const std::string& file_name, ReadCallback callback) {
+  executor_->Read(file_name, std::move(callback));
+}
+
+std::future<std::string> AsyncFileIO::Read(const std::string& file_name) {
+  auto promise = std::make_shared<std::promise<string>>();
+  auto future = promise->get_future();
+  Read(file_name, [promise](string content, std::exception_ptr error) {
+    if (error) {
+      promise->set_exception(error);
+    } else {
+      promise->set_value(std::move(content));
+    }
+  });
+  return future;
+}
+
+void AsyncFileIO::Write(const std::string& file_name, std::string content,
+                        WriteCallback callback) {
+  executor_->Write(file_name, std::move(content), std::move(callback));
+}
+
+std::future<void> AsyncFileIO::Write(const std::string& file_name,
+                                     std::string content) {
+  auto promise = std::make_shared<std::promise<void>>();
+  auto future = promise->get_future();
+  Write(file_name, std::move(content), [promise](std::exception_ptr error) {
+    if (error) {
+      promise->set_exception(error);
+    } else {
+      promise->set_value();
+    }
+  });
+  return future;
+}
+
+AsyncFileIOOptions::Backend AsyncFileIO::backend() const {
+  return executor_->backend();
+}
+
+}  // namespace quick
@@ -0,0 +1,104 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#include "quick/async_logger.hpp"
+
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+TEST(AsyncLogger, Basic) {
+  string output;
+  {
+    qk::AsyncLogger logger([&output](const char* data, std::size_t size) {
+      output.append(data, size);
+    });
+    map<int, vector<int>> m = {{1, {2, 3}}};
+    EXPECT_TRUE(logger.Log("x = ", 10, ", m = ", m));
+    logger.Flush();
+    EXPECT_EQ(output, "x = 10, m = {1: [2, 3]}\n");
+    EXPECT_TRUE(logger.Log("last"));
+  }
+  EXPECT_EQ(output, "x = 10, m = {1: [2, 3]}\nlast\n");
+}
+
+TEST(AsyncLogger, MultipleThreads) {
+  string output;
+  const int num_threads = 4, num_records = 5000;
+  uint64_t num_dropped;
+  {
+    qk::AsyncLogger logger([&output](const char* data, std::size_t size) {
+      output.append(data, size);
+    }, 256, 1024);
+    vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&logger, t]() {
+        for (int i = 0; i < num_records; i++) {
+          logger.Log("thread ", t, " record ", i);
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    logger.Flush();
+    num_dropped = logger.num_dropped();
+  }
+  EXPECT_EQ(std::count(output.begin(), output.end(), '\n') + num_dropped,
+            num_threads * num_records);
+}
+
+TEST(AsyncLogger, FlushWaitsForOwnRecords) {
+  std::mutex mutex;
+  string output;
+  qk::AsyncLogger logger([&](const char* data, std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    output.append(data, size);
+  }, 1 << 12);
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < 200; i++) {
+        string record = std::to_string(t) + ":" + std::to_string(i) + "\n";
+        if (logger.Log(t, ":", i)) {
+          logger.Flush();
+          std::lock_guard<std::mutex> lock(mutex);
+          EXPECT_NE(output.find(record), string::npos) << record;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+TEST(AsyncLogger, Reentrant) {
+  string output, inner_output;
+  {
+    qk::AsyncLogger inner_logger([&](const char* data, std::size_t size) {
+      inner_output.append(data, size);
+    });
+    struct Audited {
+      qk::AsyncLogger* logger;
+      void DebugStream(qk::DebugStream& ds) const {  // NOLINT
+        logger->Log("audited");
+        ds << "value";
+      }
+    };
+    qk::AsyncLogger logger([&](const char* data, std::size_t size) {
+      output.append(data, size);
+    });
+    logger.Log("x = ", Audited{&inner_logger}, ", y = ", 1);
+  }
+  EXPECT_EQ(output, "x = {value}, y = 1\n");
+  EXPECT_EQ(inner_output, "audited\n");
+}
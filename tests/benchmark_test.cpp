@@ -0,0 +1,88 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#include "quick/benchmark.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+qk::BenchmarkOptions FastOptions() {
+  qk::BenchmarkOptions options;
+  options.min_sample_time_ns = 200 * 1000;
+  options.warmup_time_ns = 0;
+  options.num_samples = 5;
+  return options;
+}
+
+}  // namespace
+
+TEST(BenchmarkResult, Stats) {
+  qk::BenchmarkResult result;
+  EXPECT_EQ(result.Mean(), 0);
+  EXPECT_EQ(result.Median(), 0);
+  result.samples = {4, 1, 3, 2};
+  EXPECT_DOUBLE_EQ(result.Mean(), 2.5);
+  EXPECT_DOUBLE_EQ(result.Median(), 2.5);
+  EXPECT_DOUBLE_EQ(result.Min(), 1);
+  EXPECT_NEAR(result.StdDev(), 1.29099, 1e-5);
+  result.samples.push_back(10);
+  EXPECT_DOUBLE_EQ(result.Median(), 3);
+}
+
+TEST(BenchmarkRunner, Basic) {
+  std::ostringstream oss;
+  int64_t calls = 0;
+  {
+    qk::BenchmarkRunner runner(FastOptions(), oss);
+    auto result = runner.Run("test/loop", [&]() {
+      calls++;
+      int sum = 0;
+      for (int i = 0; i < 100; i++) {
+        qk::DoNotOptimize(sum += i);
+      }
+    });
+    EXPECT_EQ(result.name, "test/loop");
+    EXPECT_EQ(result.samples.size(), 5);
+    EXPECT_GE(result.iterations_per_sample, 1);
+    EXPECT_GE(calls, 5 * static_cast<int64_t>(result.iterations_per_sample));
+    // Each sample lasts about `min_sample_time_ns` at least.
+    EXPECT_GE(result.Mean() * result.iterations_per_sample, 100 * 1000);
+    EXPECT_GT(result.Min(), 0);
+    EXPECT_EQ(runner.Results().size(), 1);
+  }
+  EXPECT_EQ(oss.str().substr(0, 10), "test/loop ");
+  EXPECT_NE(oss.str().find(" ns +- "), string::npos);
+}
+
+TEST(BenchmarkRunner, FilterAndJson) {
+  std::ostringstream oss;
+  {
+    char arg0[] = "benchmark", arg1[] = "--json", arg2[] = "--samples=3",
+         arg3[] = "keep";
+    char* argv[] = {arg0, arg1, arg2, arg3};
+    auto options = qk::BenchmarkOptions::FromArgs(4, argv);
+    EXPECT_TRUE(options.json);
+    EXPECT_EQ(options.num_samples, 3);
+    EXPECT_EQ(options.filter, "keep");
+    options.min_sample_time_ns = 100 * 1000;
+    options.warmup_time_ns = 0;
+    qk::BenchmarkRunner runner(options, oss);
+    EXPECT_TRUE(runner.Run("skipped", []() {}).samples.empty());
+    vector<int> v(100, 1);
+    EXPECT_EQ(runner.Run("keep/vector", [&]() {
+      qk::DoNotOptimize(v.data());
+      qk::ClobberMemory();
+    }).samples.size(), 3);
+    EXPECT_EQ(oss.str(), "");
+  }
+  EXPECT_EQ(oss.str().substr(0, 23), "[\n  {\n    \"name\": \"keep");
+  EXPECT_EQ(oss.str().find("skipped"), string::npos);
+}
@@ -0,0 +1,65 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#include "quick/binary_logger.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+TEST(BinaryLogger, Text) {
+  string output;
+  {
+    qk::BinaryLogger logger([&output](const char* data, std::size_t size) {
+      output.append(data, size);
+    });
+    map<int, vector<int>> m = {{1, {2, 3}}};
+    string name = "abc";
+    EXPECT_TRUE(logger.Log("x = ", 10, ", m = ", m, ", name = ", name));
+    logger.Flush();
+    EXPECT_EQ(output, "x = 10, m = {1: [2, 3]}, name = abc\n");
+    EXPECT_TRUE(logger.Log(1.5, true));
+  }
+  EXPECT_EQ(output, "x = 10, m = {1: [2, 3]}, name = abc\n1.51\n");
+}
+
+TEST(BinaryLogger, Binary) {
+  string output;
+  {
+    qk::BinaryLogger logger([&output](const char* data, std::size_t size) {
+      output.append(data, size);
+    }, qk::BinaryLogger::BINARY);
+    for (int i = 0; i < 3; i++) {
+      logger.Log("i = ", i, ", v = ", vector<string>(i, "s"));
+    }
+  }
+  string decoded;
+  auto sink = [&decoded](const char* data, std::size_t size) {
+    decoded.append(data, size);
+  };
+  EXPECT_EQ(qk::DecodeBinaryLog(output, sink), 0);
+  EXPECT_EQ(decoded, "i = 0, v = []\ni = 1, v = [s]\ni = 2, v = [s, s]\n");
+
+  decoded.clear();
+  EXPECT_EQ(qk::DecodeBinaryLog(output.substr(0, output.size() - 1), sink), 1);
+  EXPECT_EQ(decoded, "i = 0, v = []\ni = 1, v = [s]\n"
+                     "[quick::BinaryLogger]: Truncated log\n");
+}
+
+TEST(BinaryLogger, Signature) {
+  qk::ByteStream bs;
+  qk::BinaryLogger::Encode(&bs, "a", int64_t(5));
+  uint64_t id = qk::RegisterBinaryLogSignature<string, int64_t>();
+  EXPECT_EQ(id, (qk::RegisterBinaryLogSignature<const char*, int64_t>()));
+  qk::DebugStream ds;
+  EXPECT_TRUE(qk::FormatBinaryLogRecord(bs.str(), ds));
+  EXPECT_EQ(ds.str(), "a5");
+  qk::DebugStream ds2;
+  EXPECT_FALSE(qk::FormatBinaryLogRecord(string(8, 'x'), ds2));
+}
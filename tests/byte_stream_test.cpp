@@ -98,3 +98,70 @@ TEST(ByteStream, ClassMethod) {
   EXPECT_EQ(tmp_str, "Abc");
 }
 
+
+TEST(ByteStream, View) {
+  qk::ByteStream bs;
+  bs << vector<int>{1, 2, 3} << string("abc");
+  string data = bs.str();
+  qk::ByteStream view;
+  view.SetView(data.data(), data.size());
+  vector<int> v;
+  string s;
+  view >> v >> s;
+  EXPECT_EQ(v, vector<int>({1, 2, 3}));
+  EXPECT_EQ(s, "abc");
+  EXPECT_TRUE(view.end());
+  EXPECT_TRUE(view.str().empty());
+  // Truncated input.
+  view.SetView(data.data(), data.size() - 1);
+  view >> v;
+  EXPECT_ANY_THROW(view >> s);
+  view.SetView(nullptr, 0);
+  EXPECT_TRUE(view.end());
+  // Back to the owned buffer.
+  view.str(data);
+  view >> v;
+  EXPECT_EQ(v.size(), 3);
+}
+
+TEST(ByteStream, Variant) {
+  using V = qk::variant<int, string, vector<int>>;
+  vector<V> v1(4), v2;
+  v1[0].at<0>() = 17;
+  v1[1].at<1>() = "abc";
+  v1[2].at<2>() = {1, 2, 3};
+  ByteStream bs;
+  bs << v1;
+  bs >> v2;
+  ASSERT_EQ(v2.size(), 4U);
+  EXPECT_EQ(v2[0].at<0>(), 17);
+  EXPECT_EQ(v2[1].at<1>(), "abc");
+  EXPECT_EQ(v2[2].at<2>(), vector<int>({1, 2, 3}));
+  EXPECT_FALSE(v2[3].initialized());
+  EXPECT_TRUE(bs.end());
+  // Decoding into the already selected alternative reuses it in place.
+  V v3;
+  v3.at<2>().reserve(100);
+  const int* data = v3.at<2>().data();
+  ByteStream bs2;
+  bs2 << v1[2];
+  bs2 >> v3;
+  EXPECT_EQ(v3.at<2>().data(), data);
+  EXPECT_EQ(v3.at<2>(), vector<int>({1, 2, 3}));
+  ByteStream bs3;
+  bs3 << static_cast<uint32_t>(7);
+  EXPECT_THROW(bs3 >> v3, ByteStream::Error);
+}
+
+#if __cplusplus >= 201703L
+TEST(ByteStream, StdVariant) {
+  std::variant<int, string> v1 = string("xyz"), v2;
+  ByteStream bs;
+  bs << v1;
+  bs >> v2;
+  EXPECT_EQ(v1, v2);
+  ByteStream bs2;
+  bs2 << static_cast<uint32_t>(2);
+  EXPECT_THROW(bs2 >> v2, ByteStream::Error);
+}
+#endif
@@ -0,0 +1,158 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#include "quick/debug_diff.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+
+namespace {
+
+struct Point {
+  int x, y;
+  void DebugStream(qk::DebugStream& ds) const {  // NOLINT
+    ds << "(" << x << ", " << y << ")";
+  }
+};
+
+struct HashedPoint {
+  int x, y;
+  std::size_t GetHash() const {
+    return x * 31 + y;
+  }
+  void DebugStream(qk::DebugStream& ds) const {  // NOLINT
+    ds.Append("<") << x;
+    ds.Append(",") << y;
+    ds.Append(">");
+  }
+};
+
+int num_compared = 0;
+
+struct Counted {
+  int value;
+  bool operator==(const Counted& other) const {
+    num_compared++;
+    return value == other.value;
+  }
+  void DebugStream(qk::DebugStream& ds) const {  // NOLINT
+    ds << value;
+  }
+};
+
+}  // namespace
+
+TEST(DebugDiff, Equal) {
+  map<string, vector<int>> m = {{"a", {1, 2}}, {"b", {}}};
+  EXPECT_EQ(qk::DebugDiff(m, m), "");
+  EXPECT_EQ(qk::DebugDiff(5, 5), "");
+}
+
+TEST(DebugDiff, Leaves) {
+  EXPECT_EQ(qk::DebugDiff(5, 6), "~ $: 5 -> 6\n");
+  EXPECT_EQ(qk::DebugDiff(string("ab"), string("ac")), "~ $: ab -> ac\n");
+  EXPECT_EQ(qk::DebugDiff(Point{1, 2}, Point{1, 3}),
+            "~ $: {(1, 2)} -> {(1, 3)}\n");
+  EXPECT_EQ(qk::DebugDiff(Point{1, 2}, Point{1, 2}), "");
+  EXPECT_EQ(qk::DebugDiff(HashedPoint{1, 2}, HashedPoint{2, 1}),
+            "~ $: {<1,2>} -> {<2,1>}\n");
+  EXPECT_EQ(qk::DebugDiff(HashedPoint{1, 2}, HashedPoint{1, 2}), "");
+}
+
+TEST(DebugDiff, Sequences) {
+  vector<int> a = {1, 2, 3, 4, 5};
+  vector<int> b = {1, 2, 9, 4, 5};
+  EXPECT_EQ(qk::DebugDiff(a, b), "~ $[2]: 3 -> 9\n");
+  // An insertion is reported once, instead of shifting the tail.
+  b = {1, 2, 7, 3, 4, 5};
+  EXPECT_EQ(qk::DebugDiff(a, b), "+ $[2]: 7\n");
+  b = {1, 5};
+  EXPECT_EQ(qk::DebugDiff(a, b), "- $[1]: 2\n- $[2]: 3\n- $[3]: 4\n");
+  vector<vector<int>> c = {{1}, {2, 3}}, d = {{1}, {2, 4}};
+  EXPECT_EQ(qk::DebugDiff(c, d), "~ $[1][1]: 3 -> 4\n");
+  std::array<Point, 2> e = {Point{0, 0}, Point{1, 1}};
+  std::array<Point, 2> f = {Point{0, 0}, Point{1, 2}};
+  EXPECT_EQ(qk::DebugDiff(e, f), "~ $[1]: {(1, 1)} -> {(1, 2)}\n");
+  EXPECT_EQ(qk::DebugDiff(vector<bool>{true, false, true},
+                          vector<bool>{true, true, true}),
+            "~ $[1]: 0 -> 1\n");
+}
+
+TEST(DebugDiff, Maps) {
+  map<string, vector<int>> a = {{"x", {1}}, {"y", {2}}, {"z", {3}}};
+  map<string, vector<int>> b = {{"w", {0}}, {"y", {2, 5}}, {"z", {3}}};
+  EXPECT_EQ(qk::DebugDiff(a, b), "+ $[w]: [0]\n"
+                                 "- $[x]: [1]\n"
+                                 "+ $[y][1]: 5\n");
+  unordered_map<int, pair<int, string>> c = {{1, {1, "a"}}, {2, {2, "b"}}};
+  auto d = c;
+  d[2].second = "c";
+  EXPECT_EQ(qk::DebugDiff(c, d), "~ $[2].second: b -> c\n");
+  d = c;
+  d.erase(1);
+  EXPECT_EQ(qk::DebugDiff(c, d), "- $[1]: (1, a)\n");
+  EXPECT_EQ(qk::DebugDiff(d, c), "+ $[1]: (1, a)\n");
+  EXPECT_EQ(qk::DebugDiff(set<int>{1, 2, 3}, set<int>{2, 3, 4}),
+            "- $: 1\n+ $: 4\n");
+
+  // Differences of unordered containers are sorted by key.
+  unordered_map<string, int> e, f;
+  for (int i = 0; i < 50; i++) {
+    e["k" + std::to_string(i)] = i;
+  }
+  f = e;
+  f.erase("k0");
+  f["k11"] = 0;
+  f["k99"] = 0;
+  f["k22"] = -1;
+  f["a"] = 1;
+  EXPECT_EQ(qk::DebugDiff(e, f), "+ $[a]: 1\n"
+                                 "- $[k0]: 0\n"
+                                 "~ $[k11]: 11 -> 0\n"
+                                 "~ $[k22]: 22 -> -1\n"
+                                 "+ $[k99]: 0\n");
+  EXPECT_EQ(qk::DebugDiff(unordered_set<int>{5, 1, 9, 3},
+                          unordered_set<int>{7, 3, 2, 9}),
+            "- $: 1\n+ $: 2\n- $: 5\n+ $: 7\n");
+}
+
+TEST(DebugDiff, Tuples) {
+  std::tuple<int, string, vector<int>> a(1, "x", {1, 2});
+  auto b = a;
+  std::get<0>(b) = 2;
+  std::get<2>(b).push_back(3);
+  EXPECT_EQ(qk::DebugDiff(a, b), "~ $[0]: 1 -> 2\n+ $[2][2]: 3\n");
+  qk::DebugStream ds;
+  EXPECT_EQ(qk::DebugDiff(a, b, ds), 2);
+  EXPECT_EQ(qk::DebugDiff(a, a, ds), 0);
+}
+
+TEST(DebugDiff, ComparesEachLeafOnce) {
+  map<int, unordered_map<int, vector<Counted>>> a;
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 10; j++) {
+      a[i][j] = vector<Counted>(10, Counted{1});
+    }
+  }
+  auto b = a;
+  b[9][9][9].value = 2;
+  num_compared = 0;
+  EXPECT_EQ(qk::DebugDiff(a, b), "~ $[9][9][9]: {1} -> {2}\n");
+  EXPECT_EQ(num_compared, 1000);
+}
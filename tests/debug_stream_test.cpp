@@ -9,8 +9,11 @@
 #include <set>
 #include <string>
 #include <iostream>
+#include <limits>
+#include <sstream>
 
 #include <quick/unordered_map.hpp>
+#include <quick/variant.hpp>
 
 #include "gtest/gtest.h"
 
@@ -47,6 +50,43 @@ TEST(DebugStreamTest, Fundamental) {
 }
 
 
+TEST(DebugStreamTest, NumberFormatting) {
+  using quick::DebugStream;
+  DebugStream ds;
+  std::ostringstream oss;
+  auto print = [&](const auto& x) {
+    ds << x << ", ";
+    oss << x << ", ";
+  };
+  print(std::numeric_limits<int64_t>::min());
+  print(std::numeric_limits<int64_t>::max());
+  print(std::numeric_limits<uint64_t>::max());
+  print(std::numeric_limits<int32_t>::min());
+  print(static_cast<int16_t>(-1));
+  print(0);
+  print(true);
+  print(false);
+  print(3.0);
+  print(-0.000123456789);
+  print(1e100);
+  print(123456789.0f);
+  print(2.5L);
+  EXPECT_EQ(ds.str(), oss.str());
+}
+
+TEST(DebugStreamTest, LongText) {
+  string text(10000, 'x');
+  text[5000] = '\n';
+  quick::DebugStream ds;
+  ds.BranchStart('{');
+  ds << text;
+  ds.BranchEnd('}');
+  string expected_output = "{\n  " + text.substr(0, 5001) + "  " +
+                           text.substr(5001) + "\n}";
+  EXPECT_EQ(ds.str(), expected_output);
+  EXPECT_EQ(quick::DebugStream(text).str(), text);
+}
+
 TEST(DebugStreamTest, Basic) {
   using quick::DebugStream;
   string expected_output;
@@ -313,3 +353,233 @@ TEST(DebugStreamTest, ConstructorAndConsume) {
 }
 
 
+
+TEST(DebugStreamTest, Sink) {
+  vector<map<string, vector<int>>> input(20, {{"key\nA", {1, 2, 3}},
+                                              {"keyB", {}}});
+  string expected_output = quick::DebugStream(input).str();
+  for (std::size_t chunk_size : {1, 7, 64, 100000}) {
+    string output;
+    std::size_t max_chunk = 0;
+    {
+      quick::DebugStream ds;
+      ds.SetSink([&](const char* data, std::size_t size) {
+        output.append(data, size);
+        max_chunk = std::max(max_chunk, size);
+      }, chunk_size);
+      ds << input;
+      EXPECT_LT(ds.str().size(), chunk_size);
+    }
+    EXPECT_EQ(expected_output, output);
+    EXPECT_LE(max_chunk, chunk_size + 16);
+  }
+  {
+    std::ostringstream oss;
+    quick::DebugStream ds;
+    ds.SetSink(quick::OstreamSink(oss), 16);
+    ds << input;
+    ds.Flush();
+    EXPECT_EQ(expected_output, oss.str());
+  }
+  {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    {
+      quick::DebugStream ds;
+      ds.SetSink(quick::FileDescriptorSink(fds[1]));
+      ds << "a\nb";
+    }
+    close(fds[1]);
+    char data[8];
+    EXPECT_EQ(read(fds[0], data, sizeof(data)), 3);
+    EXPECT_EQ(string(data, 3), "a\nb");
+    close(fds[0]);
+  }
+  {
+    // Copies and moved-from streams don't write to the sink.
+    string output;
+    {
+      quick::DebugStream ds;
+      ds.SetSink([&](const char* data, std::size_t size) {
+        output.append(data, size);
+      });
+      ds << "abc";
+      quick::DebugStream copy(ds);
+      EXPECT_EQ(copy.str(), "abc");
+      quick::DebugStream moved(std::move(ds));
+      moved << "d";
+    }
+    EXPECT_EQ(output, "abcd");
+  }
+}
+
+TEST(DebugStreamTest, Limits) {
+  vector<int> v(10000);
+  for (int i = 0; i < v.size(); i++) {
+    v[i] = i;
+  }
+  quick::DebugLimits limits;
+  limits.max_container_size = 3;
+  EXPECT_EQ(quick::DebugStream().SetInline(true).SetLimits(limits)
+                                .Consume(v).str(),
+            "[0, 1, 2, ... (9997 more)]");
+  map<int, vector<int>> m = {{1, {1, 2, 3, 4}}, {2, {}}, {3, {5}}, {4, {}}};
+  limits.max_container_size = 2;
+  limits.max_depth = 1;
+  EXPECT_EQ(quick::DebugStream().SetInline(true).SetLimits(limits)
+                                .Consume(m).str(),
+            "{1: [...],2: [],... (2 more)}");
+  limits = quick::DebugLimits();
+  limits.max_output_size = 10;
+  quick::DebugStream ds;
+  ds.SetLimits(limits);
+  ds << v;
+  EXPECT_TRUE(ds.truncated());
+  EXPECT_EQ(ds.str(), "[\n  0, 1,  ... (truncated)");
+  ds << v;
+  EXPECT_EQ(ds.str(), "[\n  0, 1,  ... (truncated)");
+}
+
+TEST(DebugStreamTest, Json) {
+  auto to_json = [](const auto& x) {
+    return quick::DebugStream().SetJson(true).SetInline(true).Consume(x).str();
+  };
+  enum {UU, PP};
+  EXPECT_EQ(to_json(vector<int>{1, 2}), "[1, 2]");
+  EXPECT_EQ(to_json(make_pair(true, PP)), "[true, 1]");
+  EXPECT_EQ(to_json(make_pair('a', std::nan(""))), "[\"a\", null]");
+  EXPECT_EQ(to_json(map<string, vector<string>>{{"k", {"v1", "v2"}}}),
+            "{\"k\": [\"v1\", \"v2\"]}");
+  EXPECT_EQ(to_json(map<int, pair<int, int>>{{1, {2, 3}}, {4, {5, 6}}}),
+            "{\"1\": [2, 3],\"4\": [5, 6]}");
+  EXPECT_EQ(to_json(map<pair<int, string>, int>{{{1, "a"}, 2}}),
+            "{\"[1, \\\"a\\\"]\": 2}");
+  string s = "0123456789abcdef\"0123456789\\abcdef\n\x01\t";
+  EXPECT_EQ(to_json(s),
+            "\"0123456789abcdef\\\"0123456789\\\\abcdef\\n\\u0001\\t\"");
+  string long_text(100, 'x');
+  EXPECT_EQ(to_json(long_text), "\"" + long_text + "\"");
+
+  struct Node {
+    string name;
+    vector<Node> children;
+    void DebugStream(qk::DebugStream& ds) const {  // NOLINT
+      ds.Field("name", name).Field("children", children);
+    }
+  };
+  Node node = {"Root", {{"A", {}}}};
+  EXPECT_EQ(to_json(node),
+            "{\"name\": \"Root\", \"children\": "
+            "[{\"name\": \"A\", \"children\": []}]}");
+  EXPECT_EQ(quick::DebugStream().SetJson(true).Consume(node).str(),
+            "{\n"
+            "  \"name\": \"Root\",\n"
+            "  \"children\": [\n"
+            "    {\n"
+            "      \"name\": \"A\",\n"
+            "      \"children\": []\n"
+            "    }\n"
+            "  ]\n"
+            "}");
+  EXPECT_EQ(quick::DebugStream(node).str(),
+            "{\n"
+            "  name = Root\n"
+            "  children = [\n"
+            "    {\n"
+            "      name = A\n"
+            "      children = []\n"
+            "    }\n"
+            "  ]\n"
+            "}");
+
+  // Hooks writing free text are rendered as a JSON string.
+  struct Legacy {
+    void DebugStream(qk::DebugStream& ds) const {  // NOLINT
+      ds << "x = \"" << 10 << "\"";
+    }
+  };
+  EXPECT_EQ(to_json(vector<Legacy>(1)), "[\"{x = \\\"10\\\"}\"]");
+
+  // Hooks run once, and objects are streamed to the sink as they are
+  // rendered, within the limits of the whole output.
+  struct Counted {
+    int* num_calls;
+    void DebugStream(qk::DebugStream& ds) const {  // NOLINT
+      (*num_calls)++;
+      ds << "text " << 1;
+    }
+  };
+  int num_calls = 0;
+  EXPECT_EQ(to_json(Counted{&num_calls}), "\"{text 1}\"");
+  EXPECT_EQ(num_calls, 1);
+  vector<Node> nodes(200, node);
+  string expected_output = quick::DebugStream().SetJson(true).Consume(nodes)
+                               .str();
+  string output;
+  std::size_t max_buffered = 0;
+  {
+    quick::DebugStream ds;
+    ds.SetJson(true);
+    ds.SetSink([&](const char* data, std::size_t size) {
+      output.append(data, size);
+      max_buffered = std::max(max_buffered, size);
+    }, 64);
+    ds << nodes;
+  }
+  EXPECT_EQ(output, expected_output);
+  EXPECT_LE(max_buffered, 64 + 16);
+  quick::DebugLimits limits;
+  limits.max_output_size = 30;
+  EXPECT_EQ(quick::DebugStream().SetJson(true).SetInline(true)
+                .SetLimits(limits).Consume(nodes).str(),
+            "[{\"name\": \"Root\", \"children\":  ... (truncated)");
+}
+
+TEST(DebugStreamTest, MoreTypes) {
+  auto to_string = [](const auto& x) {
+    return quick::DebugStream().SetInline(true).Consume(x).str();
+  };
+  auto to_json = [](const auto& x) {
+    return quick::DebugStream().SetJson(true).SetInline(true).Consume(x).str();
+  };
+  auto t = std::make_tuple(1, string("a"), vector<int>{2, 3});
+  EXPECT_EQ(to_string(t), "(1, a, [2, 3])");
+  EXPECT_EQ(to_json(t), "[1, \"a\", [2, 3]]");
+  EXPECT_EQ(to_string(std::tuple<>()), "()");
+  EXPECT_EQ(quick::DebugStream(std::make_tuple(1, 2)).str(),
+            "(\n  1, 2\n)");
+  EXPECT_EQ(to_string(std::array<int, 3>{{4, 5, 6}}), "[4, 5, 6]");
+  EXPECT_EQ(to_string(std::deque<int>{7, 8}), "[7, 8]");
+
+  quick::variant<int, string> v;
+  EXPECT_EQ(to_string(v), "null");
+  v.at<1>() = "abc";
+  EXPECT_EQ(to_string(v), "abc");
+  EXPECT_EQ(to_json(v), "\"abc\"");
+  v.at<0>() = 5;
+  EXPECT_EQ(to_string(vector<decltype(v)>{v, v}), "[5, 5]");
+
+#if __cplusplus >= 201703L
+  std::optional<int> o;
+  EXPECT_EQ(to_string(o), "null");
+  o = 10;
+  EXPECT_EQ(to_string(o), "10");
+  std::variant<int, string> sv = "xyz";
+  EXPECT_EQ(to_json(make_pair(sv, std::optional<string>())),
+            "[\"xyz\", null]");
+#endif
+}
+
+TEST(DebugStreamTest, Layout) {
+  vector<vector<int>> v = {{1}};
+  EXPECT_EQ(quick::DebugStream().SetInline(true).Consume(v).str(),
+            "[[1]]");
+  EXPECT_EQ(quick::DebugStream().SetIndentation(4).Consume(v).str(),
+            "[\n    [\n        1\n    ]\n]");
+  // Indentation wider than the static buffer of spaces.
+  quick::DebugStream ds;
+  ds.SetIndentation(100);
+  ds << v;
+  EXPECT_EQ(ds.str(), "[\n" + string(100, ' ') + "[\n" + string(200, ' ') +
+                      "1\n" + string(100, ' ') + "]\n]");
+}
@@ -3,7 +3,9 @@
 
 #include "quick/debug.hpp"
 
+#include <iomanip>
 #include <iostream>
+#include <list>
 #include <map>
 #include <utility>
 #include <vector>
@@ -132,3 +134,75 @@ TEST(ToString, Basic) {
   EXPECT_EQ(qk::ToString(p), "(110, (10, 44))");
 }
 
+
+TEST(OstreamExtensionTest, Limits) {
+  vector<vector<int>> v(1000, vector<int>(1000, 7));
+  std::ostringstream oss;
+  quick::DebugLimits limits;
+  limits.max_container_size = 2;
+  quick::SetDebugLimits(oss, limits);
+  oss << v;
+  EXPECT_EQ(oss.str(), "[[7, 7, ... (998 more)], [7, 7, ... (998 more)], "
+                       "... (998 more)]");
+  oss.str("");
+  limits.max_depth = 1;
+  quick::SetDebugLimits(oss, limits);
+  map<int, pair<int, int>> m = {{1, {2, 3}}};
+  oss << v << " " << m;
+  EXPECT_EQ(oss.str(), "[[...], [...], ... (998 more)] {1: (...)}");
+  oss.str("");
+  limits = quick::DebugLimits();
+  limits.max_output_size = 12;
+  quick::SetDebugLimits(oss, limits);
+  oss << v << "|" << v;
+  EXPECT_EQ(oss.str(), "[[7, 7, 7, 7 ... (truncated)|"
+                       "[[7, 7, 7, 7 ... (truncated)");
+  EXPECT_TRUE(oss.good());
+  EXPECT_EQ(qk::ToString(vector<int>(100, 1)).size(), 300);
+
+  // DebugStream hooks nested in the printers continue their limits.
+  struct Node {
+    vector<int> values;
+    void DebugStream(quick::DebugStream& ds) const {  // NOLINT
+      ds << values;
+    }
+  };
+  vector<vector<Node>> nodes = {{Node{{1, 2}}}, {Node{{3}}}};
+  oss.str("");
+  limits = quick::DebugLimits();
+  limits.max_depth = 2;
+  quick::SetDebugLimits(oss, limits);
+  oss << nodes;
+  EXPECT_EQ(oss.str(), "[[{...}], [{...}]]");
+  oss.str("");
+  limits = quick::DebugLimits();
+  limits.max_output_size = 10;
+  quick::SetDebugLimits(oss, limits);
+  oss << nodes;
+  EXPECT_EQ(oss.str(), "[[{\n  [\n   ... (truncated)");
+}
+
+TEST(OstreamExtensionTest, FastPath) {
+  vector<pair<int64_t, string>> v = {{-5, "a"}, {1LL << 40, "bc"}};
+  map<string, vector<double>> m = {{"x", {1.5, 1e20, -0.25}}, {"y", {}}};
+  std::tuple<char, bool, uint16_t, set<int>> t('z', true, 65535, {3, 1});
+  unordered_map<int, std::list<float>> u = {{7, {0.1f}}};
+  std::ostringstream fast, generic;
+  // Any limit forces the generic path, which must render the same.
+  quick::DebugLimits limits;
+  limits.max_depth = 1000;
+  quick::SetDebugLimits(generic, limits);
+  fast << v << m << t << u << make_pair(1, 'c');
+  generic << v << m << t << u << make_pair(1, 'c');
+  EXPECT_EQ(fast.str(), "[(-5, a), (1099511627776, bc)]"
+                        "{x: [1.5, 1e+20, -0.25], y: []}"
+                        "(z, 1, 65535, [1, 3])"
+                        "{7: [0.1]}"
+                        "(1, c)");
+  EXPECT_EQ(fast.str(), generic.str());
+  // Non default formatting is honored.
+  std::ostringstream oss;
+  oss << std::hex << vector<int>{255, 16} << std::dec << std::setprecision(2)
+      << vector<double>{3.14159};
+  EXPECT_EQ(oss.str(), "[ff, 10][3.1]");
+}
@@ -3,9 +3,22 @@
 
 #include "quick/file_utils.hpp"
 
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdio>
+#include <future>  // NOLINT
+#include <map>
+#include <mutex>  // NOLINT
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "quick/byte_stream.hpp"
 
 using std::string;
 
@@ -17,6 +30,96 @@ TEST(ReadWriteFile, Basic) {
   EXPECT_FALSE(qk::DoesFileExist("/tmp/abx887/rr/tt/ww/qq/rr/ttt.txt"));
 }
 
+TEST(ReadFile, Sizes) {
+  string file_name = "/tmp/quick_read_file_test.bin";
+  for (std::size_t size : {0, 1, 65535, 65536, 65537, 3 << 20}) {
+    string content(size, '\0');
+    for (std::size_t i = 0; i < size; i++) {
+      content[i] = static_cast<char>(i * 131 + i / 7);
+    }
+    qk::WriteFile(file_name, content);
+    EXPECT_EQ(qk::ReadFile(file_name), content) << "size = " << size;
+  }
+  std::remove(file_name.c_str());
+}
+
+TEST(ReadFile, NonRegularFiles) {
+  // Reported with a size of 0 by fstat.
+  string status = qk::ReadFile("/proc/self/status");
+  EXPECT_NE(status.find("Name:"), string::npos);
+  try {
+    qk::ReadFile("/tmp");
+    FAIL() << "Reading a directory should throw";
+  } catch (const qk::FileException& e) {
+    EXPECT_EQ(e.type, qk::FileException::FAILED_TO_READ);
+    EXPECT_EQ(e.file_name, "/tmp");
+  }
+}
+
+TEST(WriteFileAtomically, Basic) {
+  char directory_template[] = "/tmp/quick_write_test.XXXXXX";
+  string directory = mkdtemp(directory_template);
+  string file_name = directory + "/snapshot";
+  qk::WriteFileAtomically(file_name, "v1");
+  EXPECT_EQ(qk::ReadFile(file_name), "v1");
+  chmod(file_name.c_str(), 0600);
+  string large(5 << 20, 'x');
+  for (auto durability : {qk::FileDurability::NONE, qk::FileDurability::DATA,
+                          qk::FileDurability::FULL}) {
+    large[0]++;
+    qk::WriteFileAtomically(file_name, large, durability);
+    EXPECT_EQ(qk::ReadFile(file_name), large);
+  }
+  struct stat file_stat;
+  ASSERT_EQ(stat(file_name.c_str(), &file_stat), 0);
+  EXPECT_EQ(file_stat.st_mode & 0777, 0600);
+
+  // Only the target file is left in the directory.
+  int num_files = 0;
+  DIR* dir = opendir(directory.c_str());
+  while (auto* entry = readdir(dir)) {
+    if (string(entry->d_name) != "." && string(entry->d_name) != "..") {
+      EXPECT_EQ(string(entry->d_name), "snapshot");
+      num_files++;
+    }
+  }
+  closedir(dir);
+  EXPECT_EQ(num_files, 1);
+
+  try {
+    qk::WriteFileAtomically(directory + "/missing/snapshot", "v2");
+    FAIL() << "Writing into a missing directory should throw";
+  } catch (const qk::FileException& e) {
+    EXPECT_EQ(e.type, qk::FileException::FAILED_TO_WRITE);
+  }
+  EXPECT_THROW(qk::WriteFile(directory + "/missing/snapshot", "v2"),
+               qk::FileException);
+  unlink(file_name.c_str());
+  rmdir(directory.c_str());
+}
+
+TEST(WriteFileAtomically, StaleTemporaryFiles) {
+  char directory_template[] = "/tmp/quick_write_test.XXXXXX";
+  string directory = mkdtemp(directory_template);
+  string file_name = directory + "/snapshot";
+  // Left by a crashed process with the same pid, for the next names.
+  std::vector<string> stale_files;
+  for (int i = 0; i < 1000; i++) {
+    stale_files.push_back(file_name + ".tmp." + std::to_string(getpid()) +
+                          "." + std::to_string(i));
+    qk::WriteFile(stale_files.back(), "stale");
+  }
+  qk::WriteFileAtomically(file_name, "v1", qk::FileDurability::NONE);
+  qk::WriteFileAtomically(file_name, "v2", qk::FileDurability::NONE);
+  EXPECT_EQ(qk::ReadFile(file_name), "v2");
+  for (auto& stale_file : stale_files) {
+    EXPECT_EQ(qk::ReadFile(stale_file), "stale");
+    unlink(stale_file.c_str());
+  }
+  unlink(file_name.c_str());
+  EXPECT_EQ(rmdir(directory.c_str()), 0);
+}
+
 TEST(FileException, Basic) {
   bool exception_cought = false;
   string random_file_name = "/aa/bb/cc/dd/rr/tt/tt/ww/www/rrr/ww/33/rr";
@@ -30,3 +133,314 @@ TEST(FileException, Basic) {
   EXPECT_TRUE(exception_cought);
 }
 
+
+TEST(MappedFile, Basic) {
+  string file_name = "/tmp/quick_mapped_file_test.txt";
+  string content(100000, 'x');
+  content += "end";
+  qk::WriteFile(file_name, content);
+  qk::MappedFile file(file_name);
+  ASSERT_EQ(file.size(), content.size());
+  EXPECT_EQ(string(file.data(), file.size()), content);
+#if __cplusplus >= 201703L
+  EXPECT_EQ(file.view().substr(100000), "end");
+#endif
+
+  qk::MappedFileOptions options;
+  options.access_pattern = qk::MappedFileOptions::SEQUENTIAL;
+  options.populate = true;
+  options.huge_pages = true;
+  qk::MappedFile moved(qk::MappedFile(file_name, options));
+  EXPECT_EQ(string(moved.data(), moved.size()), content);
+  file = std::move(moved);
+  EXPECT_TRUE(moved.empty());
+  EXPECT_EQ(moved.data(), nullptr);
+  EXPECT_EQ(string(file.data(), file.size()), content);
+
+  qk::WriteFile(file_name, "");
+  EXPECT_TRUE(qk::MappedFile(file_name).empty());
+  std::remove(file_name.c_str());
+  EXPECT_THROW(qk::MappedFile("/aa/bb/cc/quick_missing_file"),
+               qk::FileException);
+  EXPECT_THROW(qk::MappedFile("/tmp"), qk::FileException);
+}
+
+TEST(MappedFile, ByteStreamView) {
+  string file_name = "/tmp/quick_mapped_file_test.bin";
+  std::map<string, std::vector<int>> input = {{"a", {1, 2}}, {"b", {}}};
+  qk::ByteStream output_bs;
+  output_bs << input << string("tail");
+  qk::WriteFile(file_name, output_bs.str());
+
+  qk::MappedFile file(file_name, {qk::MappedFileOptions::RANDOM});
+  qk::ByteStream bs;
+  bs.SetView(file.data(), file.size());
+  std::map<string, std::vector<int>> output;
+  string tail;
+  bs >> output >> tail;
+  EXPECT_EQ(output, input);
+  EXPECT_EQ(tail, "tail");
+  EXPECT_TRUE(bs.end());
+  std::remove(file_name.c_str());
+}
+
+class AsyncFileIOTest
+    : public ::testing::TestWithParam<qk::AsyncFileIOOptions::Backend> {
+ protected:
+  qk::AsyncFileIOOptions Options() const {
+    qk::AsyncFileIOOptions options;
+    options.backend = GetParam();
+    options.queue_depth = 16;
+    options.num_threads = 4;
+    return options;
+  }
+};
+
+TEST_P(AsyncFileIOTest, ReadWriteMany) {
+  char directory_template[] = "/tmp/quick_async_io_test.XXXXXX";
+  string directory = mkdtemp(directory_template);
+  std::vector<string> file_names, contents;
+  for (int i = 0; i < 100; i++) {
+    file_names.push_back(directory + "/" + std::to_string(i));
+    contents.push_back(string(i * 997, static_cast<char>('a' + i % 26)));
+  }
+  contents[99] = string(5 << 20, 'z');
+  {
+    qk::AsyncFileIO io(Options());
+    std::vector<std::future<void>> writes;
+    for (int i = 0; i < 100; i++) {
+      writes.push_back(io.Write(file_names[i], contents[i]));
+    }
+    for (auto& write : writes) {
+      write.get();
+    }
+    std::vector<std::future<string>> reads;
+    for (int i = 0; i < 100; i++) {
+      reads.push_back(io.Read(file_names[i]));
+    }
+    for (int i = 0; i < 100; i++) {
+      EXPECT_EQ(reads[i].get(), contents[i]) << "file: " << i;
+    }
+    EXPECT_EQ(io.Read("/proc/self/status").get().substr(0, 5), "Name:");
+  }
+  for (auto& file_name : file_names) {
+    std::remove(file_name.c_str());
+  }
+  rmdir(directory.c_str());
+}
+
+TEST_P(AsyncFileIOTest, Errors) {
+  qk::AsyncFileIO io(Options());
+  auto missing = io.Read("/tmp/quick_async_io_missing/file");
+  try {
+    missing.get();
+    FAIL() << "Reading a missing file should throw";
+  } catch (const qk::FileException& e) {
+    EXPECT_EQ(e.type, qk::FileException::FAILED_TO_OPEN);
+  }
+  auto directory = io.Read("/tmp");
+  EXPECT_THROW(directory.get(), qk::FileException);
+  auto write = io.Write("/tmp/quick_async_io_missing/file", "abc");
+  try {
+    write.get();
+    FAIL() << "Writing in a missing directory should throw";
+  } catch (const qk::FileException& e) {
+    EXPECT_EQ(e.type, qk::FileException::FAILED_TO_WRITE);
+  }
+}
+
+TEST_P(AsyncFileIOTest, ChainedCallbacks) {
+  string file_name = "/tmp/quick_async_io_chained.txt";
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  bool done = false;
+  string result;
+  qk::AsyncFileIO io(Options());
+  io.Write(file_name, "chained", [&](std::exception_ptr error) {
+    EXPECT_FALSE(error);
+    io.Read(file_name, [&](string content, std::exception_ptr error) {
+      EXPECT_FALSE(error);
+      std::lock_guard<std::mutex> lock(mutex);
+      result = std::move(content);
+      done = true;
+      done_cv.notify_all();
+    });
+  });
+  std::unique_lock<std::mutex> lock(mutex);
+  done_cv.wait(lock, [&]() { return done; });
+  EXPECT_EQ(result, "chained");
+  std::remove(file_name.c_str());
+}
+
+TEST_P(AsyncFileIOTest, DestructorWaits) {
+  string file_name = "/tmp/quick_async_io_destructor.txt";
+  qk::WriteFile(file_name, "content");
+  std::atomic<int> num_done{0};
+  {
+    qk::AsyncFileIO io(Options());
+    for (int i = 0; i < 200; i++) {
+      io.Read(file_name, [&](string content, std::exception_ptr error) {
+        EXPECT_FALSE(error);
+        EXPECT_EQ(content, "content");
+        num_done++;
+      });
+    }
+  }
+  EXPECT_EQ(num_done.load(), 200);
+  std::remove(file_name.c_str());
+}
+
+TEST_P(AsyncFileIOTest, ZeroQueueDepth) {
+  string file_name = "/tmp/quick_async_io_zero_depth.txt";
+  qk::AsyncFileIOOptions options = Options();
+  options.queue_depth = 0;
+  options.num_threads = 0;
+  qk::AsyncFileIO io(options);
+  std::vector<std::future<void>> writes;
+  for (int i = 0; i < 10; i++) {
+    writes.push_back(io.Write(file_name + std::to_string(i), "content"));
+  }
+  for (int i = 0; i < 10; i++) {
+    writes[i].get();
+    EXPECT_EQ(io.Read(file_name + std::to_string(i)).get(), "content");
+    std::remove((file_name + std::to_string(i)).c_str());
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Backends, AsyncFileIOTest,
+                        ::testing::Values(qk::AsyncFileIOOptions::AUTO,
+                                          qk::AsyncFileIOOptions::THREAD_POOL));
+
+TEST(AsyncFileIO, Backend) {
+  qk::AsyncFileIOOptions options;
+  options.backend = qk::AsyncFileIOOptions::THREAD_POOL;
+  EXPECT_EQ(qk::AsyncFileIO(options).backend(),
+            qk::AsyncFileIOOptions::THREAD_POOL);
+  EXPECT_NE(qk::AsyncFileIO().backend(), qk::AsyncFileIOOptions::AUTO);
+}
+
+namespace {
+
+std::vector<string> ReadLines(const string& file_name,
+                              const qk::LineReaderOptions& options) {
+  qk::LineReader reader(file_name, options);
+  std::vector<string> lines;
+  const char* data;
+  std::size_t size;
+  while (reader.Next(data, size)) {
+    lines.emplace_back(data, size);
+  }
+  EXPECT_FALSE(reader.Next(data, size));
+  return lines;
+}
+
+}  // namespace
+
+TEST(LineReader, Basic) {
+  string file_name = "/tmp/quick_line_reader_test.txt";
+  std::vector<std::pair<string, std::vector<string>>> cases = {
+    {"", {}},
+    {"\n", {""}},
+    {"a", {"a"}},
+    {"a\n", {"a"}},
+    {"a\n\nbc\r\ndef", {"a", "", "bc\r", "def"}},
+  };
+  for (auto& test_case : cases) {
+    qk::WriteFile(file_name, test_case.first);
+    for (bool readahead : {false, true}) {
+      for (std::size_t buffer_size : {1, 2, 3, 1 << 20}) {
+        qk::LineReaderOptions options;
+        options.buffer_size = buffer_size;
+        options.readahead = readahead;
+        EXPECT_EQ(ReadLines(file_name, options), test_case.second)
+            << "content: " << test_case.first
+            << ", buffer_size: " << buffer_size;
+      }
+    }
+  }
+  std::remove(file_name.c_str());
+}
+
+TEST(LineReader, LargeFile) {
+  string file_name = "/tmp/quick_line_reader_large.txt";
+  std::vector<string> lines;
+  string content;
+  for (int i = 0; i < 20000; i++) {
+    // Some lines span several chunks.
+    lines.push_back(string(i % 100 == 0 ? 3000 : i % 37,
+                           static_cast<char>('a' + i % 26)));
+    content += lines.back() + "\n";
+  }
+  qk::WriteFile(file_name, content);
+  for (bool readahead : {false, true}) {
+    qk::LineReaderOptions options;
+    options.buffer_size = 1024;
+    options.readahead = readahead;
+    EXPECT_EQ(ReadLines(file_name, options), lines);
+  }
+  qk::LineReader reader(file_name);
+  string line;
+  int num_lines = 0;
+  while (reader.Next(line)) {
+    EXPECT_EQ(line, lines[num_lines++]);
+  }
+  EXPECT_EQ(num_lines, 20000);
+  std::remove(file_name.c_str());
+}
+
+TEST(LineReader, Errors) {
+  EXPECT_THROW(qk::LineReader("/tmp/quick_line_reader_missing/file"),
+               qk::FileException);
+  for (bool readahead : {false, true}) {
+    qk::LineReaderOptions options;
+    options.readahead = readahead;
+    qk::LineReader reader("/tmp", options);
+    string line;
+    try {
+      reader.Next(line);
+      FAIL() << "Reading a directory should throw";
+    } catch (const qk::FileException& e) {
+      EXPECT_EQ(e.type, qk::FileException::FAILED_TO_READ);
+    }
+  }
+  // Destroyed before reaching the end of the file.
+  qk::LineReaderOptions options;
+  options.readahead = true;
+  options.buffer_size = 16;
+  qk::LineReader reader("/proc/self/status", options);
+  string line;
+  EXPECT_TRUE(reader.Next(line));
+  EXPECT_EQ(line.substr(0, 5), "Name:");
+}
+
+TEST(LineReader, Pipe) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  ASSERT_EQ(write(fds[1], "first\nsec", 10), 10);
+  {
+    qk::LineReaderOptions options;
+    options.readahead = true;
+    qk::LineReader reader("/proc/self/fd/" + std::to_string(fds[0]), options);
+    string line;
+    EXPECT_TRUE(reader.Next(line));
+    EXPECT_EQ(line, "first");
+    // Destroyed while the writer is still open, without waiting for it.
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+#if __cplusplus >= 201703L
+TEST(LineReader, StringView) {
+  string file_name = "/tmp/quick_line_reader_view.txt";
+  qk::WriteFile(file_name, "first\nsecond\n");
+  qk::LineReader reader(file_name);
+  std::string_view line;
+  EXPECT_TRUE(reader.Next(line));
+  EXPECT_EQ(line, "first");
+  EXPECT_TRUE(reader.Next(line));
+  EXPECT_EQ(line, "second");
+  EXPECT_FALSE(reader.Next(line));
+  std::remove(file_name.c_str());
+}
+#endif
@@ -130,3 +130,26 @@ TEST(HashTest, HashFunction) {
   EXPECT_NE(qk::HashFunction(10, 20, 30, 40), 0ULL);
 }
 
+
+TEST(HashTest, Variant) {
+  using V = qk::variant<int, string, int>;
+  V v1, v2, v3;
+  qk::hash<V> hasher;
+  EXPECT_EQ(hasher(v1), hasher(v2));
+  v1.at<0>() = 5;
+  v2.at<0>() = 5;
+  v3.at<2>() = 5;
+  EXPECT_EQ(hasher(v1), hasher(v2));
+  // Same value in a different alternative.
+  EXPECT_NE(hasher(v1), hasher(v3));
+  v2.at<1>() = "5";
+  EXPECT_NE(hasher(v1), hasher(v2));
+  qk::hash<vector<V>> vector_hasher;
+  EXPECT_EQ(vector_hasher({v1, v2}), vector_hasher({v1, v2}));
+#if __cplusplus >= 201703L
+  std::variant<int, string> s1 = 5, s2 = string("5");
+  EXPECT_NE(qk::HashFunction(s1), qk::HashFunction(s2));
+  std::variant<int, string> s3 = 5;
+  EXPECT_EQ(qk::HashFunction(s1), qk::HashFunction(s3));
+#endif
+}
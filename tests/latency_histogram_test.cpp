@@ -0,0 +1,117 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#include "quick/latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using std::string;
+using std::vector;
+
+TEST(LatencyHistogram, Basic) {
+  qk::LatencyHistogram histogram;
+  EXPECT_EQ(histogram.Count(), 0);
+  EXPECT_EQ(histogram.Percentile(50), 0);
+  EXPECT_EQ(histogram.Min(), 0);
+  for (int i = 1; i <= 100; i++) {
+    histogram.Record(i);
+  }
+  EXPECT_EQ(histogram.Count(), 100);
+  EXPECT_EQ(histogram.Min(), 1);
+  EXPECT_EQ(histogram.Max(), 100);
+  EXPECT_DOUBLE_EQ(histogram.Mean(), 50.5);
+  // Values below 128 are exact with 2 significant digits.
+  EXPECT_EQ(histogram.Percentile(50), 50);
+  EXPECT_EQ(histogram.Percentile(99), 99);
+  EXPECT_EQ(histogram.Percentile(100), 100);
+  EXPECT_EQ(histogram.Percentile(0), 1);
+  histogram.Record(-5);
+  histogram.Record(histogram.HighestValue() + 1000, 2);
+  EXPECT_EQ(histogram.Min(), 0);
+  EXPECT_EQ(histogram.Max(), histogram.HighestValue());
+  EXPECT_EQ(histogram.Count(), 103);
+  histogram.Clear();
+  EXPECT_EQ(histogram.Count(), 0);
+  EXPECT_EQ(histogram.Max(), 0);
+  EXPECT_EQ(qk::LatencyHistogram(1000000, 3).SignificantDigits(), 3);
+  EXPECT_THROW(qk::LatencyHistogram(1000, 0), std::runtime_error);
+  EXPECT_THROW(qk::LatencyHistogram(0, 2), std::runtime_error);
+}
+
+TEST(LatencyHistogram, Precision) {
+  std::mt19937_64 rng(7);
+  std::lognormal_distribution<double> distribution(8, 2);
+  for (int digits : {1, 2, 3}) {
+    qk::LatencyHistogram histogram(int64_t(1) << 40, digits);
+    vector<int64_t> samples;
+    for (int i = 0; i < 100000; i++) {
+      samples.push_back(static_cast<int64_t>(distribution(rng)));
+      histogram.Record(samples.back());
+    }
+    std::sort(samples.begin(), samples.end());
+    for (double p : {1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+      auto rank = static_cast<std::size_t>(std::ceil(p / 100 *
+                                                     samples.size()));
+      int64_t exact = samples[std::max<std::size_t>(rank, 1) - 1];
+      int64_t approx = histogram.Percentile(p);
+      EXPECT_GE(approx, exact);
+      EXPECT_LE(approx - exact, exact * std::pow(10, -digits))
+          << "digits = " << digits << ", p = " << p;
+    }
+  }
+}
+
+TEST(LatencyHistogram, Merge) {
+  qk::LatencyHistogram h1, h2, all;
+  for (int i = 0; i < 1000; i++) {
+    h1.Record(i * 7);
+    all.Record(i * 7);
+    h2.Record(i * 13 + 5);
+    all.Record(i * 13 + 5);
+  }
+  h1.Merge(h2);
+  EXPECT_EQ(h1, all);
+  EXPECT_EQ(h1.Min(), 0);
+  EXPECT_EQ(h1.Max(), 999 * 13 + 5);
+  qk::LatencyHistogram other(1000, 2);
+  EXPECT_THROW(h1.Merge(other), std::runtime_error);
+}
+
+TEST(LatencyHistogram, ByteStream) {
+  qk::LatencyHistogram histogram(1000000000, 3);
+  for (int i = 0; i < 10000; i++) {
+    histogram.Record((i * 7919) % 1000003);
+  }
+  qk::ByteStream bs;
+  bs << histogram;
+  // Only the non empty buckets are written.
+  EXPECT_LT(bs.str().size(), histogram.NumBuckets() * sizeof(uint64_t));
+  qk::LatencyHistogram output;
+  bs >> output;
+  EXPECT_EQ(output, histogram);
+  EXPECT_EQ(output.SignificantDigits(), 3);
+  EXPECT_EQ(output.Percentile(99.9), histogram.Percentile(99.9));
+  EXPECT_NE(output, qk::LatencyHistogram(1000000000, 3));
+}
+
+TEST(LatencyHistogram, DebugStream) {
+  qk::LatencyHistogram histogram;
+  histogram.Record(10, 3);
+  EXPECT_EQ(qk::DebugStream(histogram).str(),
+            "{\n"
+            "  count = 3\n"
+            "  min = 10\n"
+            "  mean = 10\n"
+            "  p50 = 10\n"
+            "  p90 = 10\n"
+            "  p99 = 10\n"
+            "  p999 = 10\n"
+            "  max = 10\n"
+            "}");
+}
@@ -0,0 +1,67 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#include "quick/mpsc_ring_buffer.hpp"
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using std::string;
+using std::vector;
+
+TEST(MpscRingBuffer, Basic) {
+  qk::MpscRingBuffer<string> queue(4);
+  EXPECT_EQ(queue.capacity(), 4);
+  string s;
+  EXPECT_FALSE(queue.TryPop(s));
+  for (int i = 0; i < 4; i++) {
+    s = std::to_string(i);
+    EXPECT_TRUE(queue.TryPush(s));
+  }
+  s = "overflow";
+  EXPECT_FALSE(queue.TryPush(s));
+  EXPECT_EQ(s, "overflow");
+  EXPECT_EQ(queue.num_claimed(), 4);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.TryPop(s));
+    EXPECT_EQ(s, std::to_string(i));
+  }
+  EXPECT_FALSE(queue.TryPop(s));
+  EXPECT_THROW(qk::MpscRingBuffer<int>(6), std::invalid_argument);
+}
+
+TEST(MpscRingBuffer, MultipleProducers) {
+  qk::MpscRingBuffer<int64_t> queue(64);
+  const int num_producers = 4, num_items = 20000;
+  vector<std::thread> producers;
+  for (int p = 0; p < num_producers; p++) {
+    producers.emplace_back([&queue, p]() {
+      for (int i = 0; i < num_items; i++) {
+        int64_t value = p * num_items + i;
+        while (not queue.TryPush(value)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  vector<int> last_seen(num_producers, -1);
+  int64_t sum = 0, value = 0;
+  for (int num_popped = 0; num_popped < num_producers * num_items;) {
+    if (queue.TryPop(value)) {
+      int p = value / num_items, i = value % num_items;
+      // Items of a producer are popped in order.
+      EXPECT_EQ(last_seen[p] + 1, i);
+      last_seen[p] = i;
+      sum += value;
+      num_popped++;
+    }
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  int64_t n = num_producers * num_items;
+  EXPECT_EQ(sum, n * (n - 1) / 2);
+}
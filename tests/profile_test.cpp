@@ -0,0 +1,117 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#include "quick/profile.hpp"
+
+#include <chrono>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+const qk::ProfileZoneStats* FindZone(const qk::ProfileReport& report,
+                                     const string& name) {
+  for (auto& zone : report.zones) {
+    if (zone.name == name) {
+      return &zone;
+    }
+  }
+  return nullptr;
+}
+
+void Sleep(int micro_seconds) {
+  QUICK_PROFILE_SCOPE("ProfileTest.Sleep");
+  std::this_thread::sleep_for(std::chrono::microseconds(micro_seconds));
+}
+
+}  // namespace
+
+TEST(Profile, BucketIndex) {
+  using qk::profile_impl::BucketIndex;
+  using qk::profile_impl::BucketValue;
+  using qk::profile_impl::kNumBuckets;
+  for (uint64_t i = 0; i < 16; i++) {
+    EXPECT_EQ(BucketIndex(i), i);
+  }
+  EXPECT_EQ(BucketIndex(17), 16);
+  EXPECT_EQ(BucketIndex(18), 17);
+  EXPECT_EQ(BucketIndex(~uint64_t(0)), kNumBuckets - 1);
+  for (uint64_t value : {1ULL, 100ULL, 12345ULL, 1ULL << 40, 999999999ULL}) {
+    uint64_t approx = BucketValue(BucketIndex(value));
+    EXPECT_LE(std::abs(static_cast<double>(approx) - value), value / 8.0);
+  }
+  std::size_t last = 0;
+  for (uint64_t value = 1; value < (1 << 20); value = value * 3 / 2 + 1) {
+    EXPECT_GE(BucketIndex(value), last);
+    last = BucketIndex(value);
+  }
+}
+
+TEST(Profile, Basic) {
+  Sleep(1000);
+  for (int i = 0; i < 10; i++) {
+    QUICK_PROFILE_SCOPE("ProfileTest.Loop");
+  }
+  auto report = qk::GetProfileReport();
+  auto* sleep = FindZone(report, "ProfileTest.Sleep");
+  ASSERT_NE(sleep, nullptr);
+  EXPECT_EQ(sleep->count, 1);
+  EXPECT_GE(sleep->total_ns, 900000);
+  EXPECT_EQ(sleep->min_ns, sleep->max_ns);
+  EXPECT_EQ(sleep->PercentileNanoSeconds(50), sleep->max_ns);
+  auto* loop = FindZone(report, "ProfileTest.Loop");
+  ASSERT_NE(loop, nullptr);
+  EXPECT_EQ(loop->count, 10);
+  EXPECT_LE(loop->min_ns, loop->PercentileNanoSeconds(50));
+  EXPECT_LE(loop->PercentileNanoSeconds(50), loop->max_ns);
+  EXPECT_LT(loop->total_ns, sleep->total_ns);
+  string text = qk::DebugStream(report).str();
+  EXPECT_NE(text.find("name = ProfileTest.Sleep"), string::npos);
+  EXPECT_NE(text.find("count = 1\n"), string::npos);
+}
+
+TEST(Profile, MultiThread) {
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([]() {
+      for (int i = 0; i < 1000; i++) {
+        QUICK_PROFILE_SCOPE("ProfileTest.MultiThread");
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // Same name from another call site.
+  {
+    QUICK_PROFILE_SCOPE("ProfileTest.MultiThread");
+  }
+  auto report = qk::GetProfileReport();
+  auto* zone = FindZone(report, "ProfileTest.MultiThread");
+  ASSERT_NE(zone, nullptr);
+  EXPECT_EQ(zone->count, 4001);
+  uint64_t bucket_total = 0;
+  for (auto count : zone->buckets) {
+    bucket_total += count;
+  }
+  EXPECT_EQ(bucket_total, 4001);
+}
+
+TEST(ProfileReporter, Basic) {
+  string output;
+  {
+    qk::ProfileReporter reporter(
+        [&output](const char* data, std::size_t size) {
+          output.append(data, size);
+        },
+        std::chrono::milliseconds(1000));
+    QUICK_PROFILE_SCOPE("ProfileTest.Reporter");
+  }
+  EXPECT_NE(output.find("name = ProfileTest.Reporter"), string::npos);
+}
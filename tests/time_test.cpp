@@ -2,6 +2,7 @@
 // Author: Mohit Saini (mohitsaini1196@gmail.com)
 
 #include <chrono>  // NOLINT
+#include <iostream>
 #include <thread>  // NOLINT
 
 #include "gtest/gtest.h"
@@ -25,3 +26,29 @@ TEST(MicroSecondTimer, Basic) {
   EXPECT_GT(t2, t1);
 }
 
+
+TEST(NanoTimer, Basic) {
+  qk::NanoTimer timer;
+  int64_t t1 = timer.GetStartTime();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_GE(timer.GetElapsedTime(), 1000000);
+  timer.Restart();
+  EXPECT_GT(timer.GetStartTime(), t1);
+  int64_t t2 = qk::GetSteadyNanoSeconds();
+  int64_t t3 = qk::GetSteadyNanoSeconds();
+  EXPECT_LE(t2, t3);
+}
+
+TEST(CycleTimer, Basic) {
+  qk::CycleTimer timer;
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  int64_t elapsed = timer.GetElapsedTime();
+  EXPECT_GE(elapsed, 1500000);
+  EXPECT_LT(elapsed, 2000000000);
+  EXPECT_GT(timer.GetElapsedTicks(), 0U);
+  timer.Restart();
+  EXPECT_LT(timer.GetElapsedTime(), 1000000000);
+  uint64_t t1 = qk::CycleTimer::Now();
+  uint64_t t2 = qk::CycleTimer::NowOrdered();
+  EXPECT_LE(t1, t2);
+}
@@ -0,0 +1,120 @@
+// Copyright: 2019 Mohit Saini
+// Author: Mohit Saini (mohitsaini1196@gmail.com)
+
+#include "quick/trace.hpp"
+
+#include <chrono>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+int Count(const string& text, const string& pattern) {
+  int count = 0;
+  for (auto pos = text.find(pattern); pos != string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST(Trace, Disabled) {
+  qk::StopTracing();
+  EXPECT_FALSE(qk::IsTracingEnabled());
+  {
+    QUICK_TRACE_SCOPE("Trace.Disabled");
+    qk::TraceInstant("Trace.Disabled.Instant");
+  }
+  string trace = qk::ExportChromeTrace();
+  EXPECT_EQ(trace.find("Trace.Disabled"), string::npos);
+  EXPECT_EQ(trace.substr(0, 16), "{\"traceEvents\": ");
+}
+
+TEST(Trace, Basic) {
+  qk::StartTracing();
+  EXPECT_TRUE(qk::IsTracingEnabled());
+  qk::SetTraceThreadName("main \"thread\"");
+  {
+    QUICK_TRACE_SCOPE("Trace.Scope");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    qk::TraceBegin("Trace.Span");
+    qk::TraceInstant("Trace.Instant");
+    qk::TraceEnd("Trace.Span");
+  }
+  qk::StopTracing();
+  {
+    QUICK_TRACE_SCOPE("Trace.AfterStop");
+  }
+  string trace = qk::ExportChromeTrace();
+  EXPECT_NE(trace.find("{\"name\": \"thread_name\", \"ph\": \"M\""),
+            string::npos);
+  EXPECT_NE(trace.find("\"args\": {\"name\": \"main \\\"thread\\\"\"}"),
+            string::npos);
+  EXPECT_NE(trace.find("{\"name\": \"Trace.Scope\", \"ph\": \"X\""),
+            string::npos);
+  EXPECT_EQ(Count(trace, "\"Trace.Span\", \"ph\": \"B\""), 1);
+  EXPECT_EQ(Count(trace, "\"Trace.Span\", \"ph\": \"E\""), 1);
+  EXPECT_NE(trace.find("\"Trace.Instant\", \"ph\": \"i\""), string::npos);
+  EXPECT_EQ(trace.find("Trace.AfterStop"), string::npos);
+  // The scope lasted at least 1ms.
+  auto dur = trace.find("\"dur\": ", trace.find("Trace.Scope"));
+  ASSERT_NE(dur, string::npos);
+  EXPECT_GE(std::stod(trace.substr(dur + 7)), 900.0);
+  EXPECT_EQ(trace.substr(trace.size() - 29),
+            "\n], \"displayTimeUnit\": \"ns\"}\n");
+
+  // Restarting discards the previous events.
+  qk::StartTracing();
+  qk::StopTracing();
+  EXPECT_EQ(qk::ExportChromeTrace().find("Trace.Scope"), string::npos);
+}
+
+TEST(Trace, MultiThreadRingBuffer) {
+  qk::StartTracing(64);
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([]() {
+      for (int i = 0; i < 1000; i++) {
+        QUICK_TRACE_SCOPE("Trace.Worker");
+      }
+    });
+  }
+  // Exporting while the threads are recording.
+  string concurrent = qk::ExportChromeTrace();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  qk::StopTracing();
+  string trace = qk::ExportChromeTrace();
+  // New threads keep only their last 64 events.
+  EXPECT_EQ(Count(trace, "\"Trace.Worker\""), 4 * 64);
+  EXPECT_LE(Count(concurrent, "\"Trace.Worker\""), 4 * 64);
+}
+
+TEST(Trace, ExportDoesNotBlockRegistry) {
+  qk::StartTracing();
+  {
+    QUICK_TRACE_SCOPE("Trace.Exported");
+  }
+  qk::StopTracing();
+  string output;
+  qk::DebugStream ds;
+  // A slow sink mustn't block the threads naming or registering themselves.
+  ds.SetSink([&output](const char* data, std::size_t size) {
+    qk::SetTraceThreadName("sink");
+    std::thread([]() { QUICK_TRACE_SCOPE("Trace.NewThread"); }).join();
+    output.append(data, size);
+  }, 16);
+  qk::ExportChromeTrace(ds);
+  ds.Flush();
+  EXPECT_NE(output.find("\"Trace.Exported\""), string::npos);
+  EXPECT_EQ(output.substr(output.size() - 2), "}\n");
+}
@@ -3,7 +3,10 @@
 
 #include "quick/variant.hpp"
 
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 #include <string>
 #include <quick/debug.hpp>
@@ -130,13 +133,185 @@ TEST(QuickVariant, CustomType) {
   }
 }
 
+TEST(QuickVariant, InlineStorage) {
+  struct Big {
+    char data[256];
+    int x;
+  };
+  using V = qk::variant<int, double, Big>;
+  // Big is on the heap, leaving the pointer and the discriminator inline.
+  EXPECT_LE(sizeof(V), 2 * sizeof(std::size_t));
+  EXPECT_LE(sizeof(qk::variant<int, string>),
+            sizeof(string) + sizeof(std::size_t));
+  V v1;
+  v1.at<2>().x = 17;
+  V v2 = v1;
+  v1.at<2>().x = 18;
+  EXPECT_EQ(v2.at<2>().x, 17);
+  V v3 = std::move(v1);
+  EXPECT_EQ(v3.at<2>().x, 18);
+  v3.at<1>() = 2.5;
+  EXPECT_EQ(v3.selected_type(), 1U);
+  v2 = v3;
+  EXPECT_EQ(v2.at<1>(), 2.5);
+}
 
+TEST(QuickVariant, ThrowingConstructor) {
+  struct Throwing {
+    explicit Throwing(int x) {
+      if (x < 0) {
+        throw std::runtime_error("negative");
+      }
+    }
+  };
+  qk::variant<string, Throwing> v;
+  v.at<0>() = "abc";
+  EXPECT_ANY_THROW(v.at<1>(-1));
+  EXPECT_FALSE(v.initialized());
+  v.at<1>(1);
+  EXPECT_EQ(v.selected_type(), 1U);
+}
 
+TEST(QuickVariant, Visit) {
+  struct Printer {
+    string operator()(int x) const { return "int:" + std::to_string(x); }
+    string operator()(const string& x) const { return "string:" + x; }
+    string operator()(const vector<int>& x) const {
+      return "vector:" + std::to_string(x.size());
+    }
+  };
+  qk::variant<int, string, vector<int>> v;
+  EXPECT_ANY_THROW(qk::visit(Printer(), v));
+  v.at<0>() = 5;
+  EXPECT_EQ(qk::visit(Printer(), v), "int:5");
+  v.at<2>(3, 1);
+  const auto& cv = v;
+  EXPECT_EQ(qk::visit(Printer(), cv), "vector:3");
+  // Mutable access.
+  v.at<1>() = "ab";
+  qk::visit([](auto& x) { x = std::decay_t<decltype(x)>(); }, v);
+  EXPECT_EQ(v.at<1>(), "");
+  // Rvalue variants pass rvalue alternatives.
+  v.at<1>() = "moved";
+  string target;
+  qk::visit([&target](auto&& x) {
+    using T = std::decay_t<decltype(x)>;
+    EXPECT_TRUE((std::is_rvalue_reference<decltype(x)>::value));
+    if (std::is_same<T, string>::value) {
+      target = qk::ToString(x);
+    }
+  }, std::move(v));
+  EXPECT_EQ(target, "moved");
+}
 
+TEST(QuickVariant, MultiVisit) {
+  qk::variant<int, double> a;
+  qk::variant<string, int, char> b;
+  auto describe = [](const auto& x, const auto& y) {
+    return qk::ToString(x) + "," + qk::ToString(y);
+  };
+  a.at<1>() = 1.5;
+  b.at<2>() = 'c';
+  EXPECT_EQ(qk::visit(describe, a, b), "1.5,c");
+  a.at<0>() = 7;
+  b.at<0>() = "s";
+  EXPECT_EQ(qk::visit(describe, a, b), "7,s");
+  b.at<1>() = 9;
+  EXPECT_EQ(qk::visit(describe, a, b), "7,9");
+  EXPECT_EQ(qk::visit([](auto x, auto y, auto z) { return x + y + z; },
+                      a, a, a), 21);
+  b.clear();
+  EXPECT_ANY_THROW(qk::visit(describe, a, b));
+}
 
+TEST(QuickVariant, TriviallyCopyable) {
+  struct Pod {
+    int x;
+    double y;
+  };
+  using V = qk::variant<int, double, Pod>;
+  static_assert(std::is_trivially_copyable<V>::value, "");
+  static_assert(std::is_trivially_destructible<V>::value, "");
+  static_assert(not std::is_trivially_copyable<qk::variant<int, string>>::value,
+                "");
+  vector<V> v(3);
+  v[0].at<0>() = 3;
+  v[1].at<2>() = Pod{4, 5.5};
+  auto v2 = v;
+  EXPECT_EQ(v2[0].at<0>(), 3);
+  EXPECT_EQ(v2[1].at<2>().y, 5.5);
+  EXPECT_FALSE(v2[2].initialized());
+  V x;
+  std::memcpy(static_cast<void*>(&x), &v[1], sizeof(V));
+  EXPECT_EQ(x.at<2>().x, 4);
+  x.clear();
+  EXPECT_FALSE(x.initialized());
+}
 
+TEST(QuickVariant, HeapMoveStealsOwnership) {
+  struct Big {
+    vector<int> data;
+    char padding[256];
+  };
+  qk::variant<int, Big> v1, v2;
+  v1.at<1>().data = {1, 2, 3};
+  const int* data = v1.at<1>().data.data();
+  const Big* big = &v1.at<1>();
+  v2 = std::move(v1);
+  EXPECT_FALSE(v1.initialized());
+  EXPECT_EQ(&v2.at<1>(), big);
+  EXPECT_EQ(v2.at<1>().data.data(), data);
+  qk::variant<int, Big> v3(std::move(v2));
+  EXPECT_FALSE(v2.initialized());
+  EXPECT_EQ(&v3.at<1>(), big);
+  // Assigning over the same alternative releases the old one.
+  v1.at<1>().data = {4};
+  v1 = std::move(v3);
+  EXPECT_EQ(v1.at<1>().data.size(), 3U);
+}
 
+TEST(QuickVariant, NothrowMove) {
+  struct ThrowingMove {
+    ThrowingMove() = default;
+    ThrowingMove(ThrowingMove&&) {}  // NOLINT
+    ThrowingMove& operator=(ThrowingMove&&) {  // NOLINT
+      return *this;
+    }
+  };
+  struct BigThrowingMove : ThrowingMove {
+    char padding[256];
+  };
+  using V = qk::variant<string, int>;
+  static_assert(std::is_nothrow_move_constructible<V>::value, "");
+  static_assert(std::is_nothrow_move_assignable<V>::value, "");
+  // Moves of heap allocated alternatives only steal the pointer.
+  static_assert(std::is_nothrow_move_constructible<
+                    qk::variant<int, BigThrowingMove>>::value, "");
+  static_assert(not std::is_nothrow_move_constructible<
+                    qk::variant<int, ThrowingMove>>::value, "");
+  static_assert(not std::is_nothrow_move_assignable<
+                    qk::variant<int, ThrowingMove>>::value, "");
+  // Hence std::vector moves the elements on reallocation.
+  vector<V> values(1);
+  values[0].at<0>() = string(100, 'x');
+  const char* data = values[0].at<0>().data();
+  values.resize(values.capacity() + 1);
+  EXPECT_EQ(values[0].at<0>().data(), data);
+}
 
-
-
-
+TEST(QuickVariant, CompactDiscriminator) {
+  static_assert(sizeof(qk::variant<int, float>) == 8, "");
+  static_assert(sizeof(qk::variant<char, bool>) == 2, "");
+  static_assert(sizeof(qk::variant<int, string>) == sizeof(string) + 8, "");
+  static_assert(std::is_same<qk::variant_impl::SmallestUnsigned<255>,
+                             uint8_t>::value, "");
+  static_assert(std::is_same<qk::variant_impl::SmallestUnsigned<256>,
+                             uint16_t>::value, "");
+  static_assert(std::is_same<qk::variant_impl::SmallestUnsigned<70000>,
+                             uint32_t>::value, "");
+  qk::variant<char, bool> v;
+  EXPECT_EQ(v.selected_type(), 2U);
+  v.at<1>() = true;
+  EXPECT_EQ(v.selected_type(), 1U);
+  EXPECT_TRUE(v.at<1>());
+}
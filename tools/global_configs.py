@@ -51,15 +51,30 @@ configs.dependency_configs = [
   br.CppLibrary("src/debug",
                 hdrs = ["include/quick/debug.hpp"]),
 
+  br.CppLibrary("src/benchmark",
+                hdrs = ["include/quick/benchmark.hpp"],
+                deps = ["src/debug_stream", "src/time"]),
+
+  br.CppProgram("benchmarks/debug_benchmark",
+                srcs = ["benchmarks/debug_benchmark.cpp"],
+                deps = ["src/benchmark", "src/debug"]),
+
+  br.CppProgram("benchmarks/quick_benchmark",
+                srcs = ["benchmarks/quick_benchmark.cpp"],
+                deps = ["src/benchmark", "src/byte_stream", "src/debug_stream",
+                        "src/hash", "src/stl_utils"]),
+
   br.CppLibrary("src/alias",
                 hdrs = ["include/quick/alias.hpp"]),
 
   br.CppLibrary("src/file_utils",
                 hdrs = ["include/quick/file_utils.hpp"],
-                srcs = ["src/file_utils.cpp"]),
+                srcs = ["src/file_utils.cpp"],
+                global_link_flags = "-lpthread"),
 
   br.CppLibrary("src/hash",
-                hdrs = ["include/quick/hash.hpp"]),
+                hdrs = ["include/quick/hash.hpp"],
+                deps = ["src/variant"]),
 
   br.CppLibrary("src/unordered_map",
                 hdrs = ["include/quick/unordered_map.hpp"],
@@ -68,17 +83,67 @@ configs.dependency_configs = [
   br.CppLibrary("src/time",
                 hdrs = ["include/quick/time.hpp"]),
 
+  br.CppLibrary("src/latency_histogram",
+                hdrs = ["include/quick/latency_histogram.hpp"],
+                deps = ["src/byte_stream", "src/debug_stream"]),
+
+  br.CppLibrary("src/profile",
+                hdrs = ["include/quick/profile.hpp"],
+                deps = ["src/latency_histogram", "src/time"],
+                global_link_flags = "-lpthread"),
+
+  br.CppLibrary("src/trace",
+                hdrs = ["include/quick/trace.hpp"],
+                deps = ["src/debug_stream", "src/time"],
+                global_link_flags = "-lpthread"),
+
   br.CppLibrary("src/byte_stream",
                 hdrs = ["include/quick/byte_stream.hpp"],
-                deps = []),
+                deps = ["src/variant"]),
 
   br.CppLibrary("src/debug_stream",
                 hdrs = ["include/quick/debug_stream.hpp"],
                 deps = []),
 
+  br.CppLibrary("src/debug_diff",
+                hdrs = ["include/quick/debug_diff.hpp"],
+                deps = ["src/debug_stream", "src/hash", "src/type_traits"]),
+
+  br.CppLibrary("src/mpsc_ring_buffer",
+                hdrs = ["include/quick/mpsc_ring_buffer.hpp"],
+                global_link_flags = "-lpthread"),
+
+  br.CppLibrary("src/async_logger",
+                hdrs = ["include/quick/async_logger.hpp"],
+                deps = ["src/debug_stream", "src/mpsc_ring_buffer"]),
+
+  br.CppLibrary("src/binary_logger",
+                hdrs = ["include/quick/binary_logger.hpp"],
+                deps = ["src/async_logger", "src/byte_stream"]),
+
   br.CppTest("tests/debug_stream_test",
                 srcs = ["tests/debug_stream_test.cpp"],
-                deps = ["src/debug_stream"]),
+                deps = ["src/debug_stream", "src/variant"]),
+
+  br.CppTest("tests/debug_diff_test",
+             srcs = ["tests/debug_diff_test.cpp"],
+             deps = ["src/debug_diff"]),
+
+  br.CppTest("tests/mpsc_ring_buffer_test",
+             srcs = ["tests/mpsc_ring_buffer_test.cpp"],
+             deps = ["src/mpsc_ring_buffer"]),
+
+  br.CppTest("tests/async_logger_test",
+             srcs = ["tests/async_logger_test.cpp"],
+             deps = ["src/async_logger"]),
+
+  br.CppTest("tests/binary_logger_test",
+             srcs = ["tests/binary_logger_test.cpp"],
+             deps = ["src/binary_logger"]),
+
+  br.CppTest("tests/benchmark_test",
+             srcs = ["tests/benchmark_test.cpp"],
+             deps = ["src/benchmark"]),
 
   br.CppTest("tests/byte_stream_test",
              srcs = ["tests/byte_stream_test.cpp"],
@@ -108,7 +173,7 @@ configs.dependency_configs = [
 
   br.CppTest("tests/file_utils_test",
                 srcs = ["tests/file_utils_test.cpp"],
-                deps = ["src/file_utils"]),
+                deps = ["src/file_utils", "src/byte_stream"]),
 
   br.CppTest("tests/hash_test",
                 srcs = ["tests/hash_test.cpp"],
@@ -123,6 +188,18 @@ configs.dependency_configs = [
                 srcs = ["tests/time_test.cpp"],
                 deps = ["src/time"]),
 
+  br.CppTest("tests/latency_histogram_test",
+                srcs = ["tests/latency_histogram_test.cpp"],
+                deps = ["src/latency_histogram"]),
+
+  br.CppTest("tests/profile_test",
+                srcs = ["tests/profile_test.cpp"],
+                deps = ["src/profile"]),
+
+  br.CppTest("tests/trace_test",
+                srcs = ["tests/trace_test.cpp"],
+                deps = ["src/trace"]),
+
   br.CppTest("tests/type_traits_test",
                 srcs = ["tests/type_traits_test.cpp"],
                 deps = ["src/type_traits"]),